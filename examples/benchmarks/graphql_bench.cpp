@@ -0,0 +1,108 @@
+// Compares TypedExecutor::prepare() with the parsed-query cache off (parse,
+// fragment expansion, schema validation and planning on every call) against
+// cache hits, for the queries in graphql_server/sample_queries.json.
+// Mutations are skipped: the typed executor doesn't run them.
+#include "graphql/typed_executor.hpp"
+#include "logger.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace NSNAME;
+
+struct NullProvider
+{};
+
+class BenchExecutor : public graphql::TypedExecutor<NullProvider>
+{
+  public:
+    using graphql::TypedExecutor<NullProvider>::TypedExecutor;
+
+  protected:
+    boost::asio::awaitable<graphql::Result<nlohmann::json>>
+        resolveRootField(const graphql::FieldSelection&,
+                         const graphql::FieldSpec&,
+                         const nlohmann::json&) override
+    {
+        co_return nlohmann::json(nullptr);
+    }
+};
+
+// Root fields of the users/posts sample service.
+graphql::TypedSchema makeSchema()
+{
+    graphql::TypedSchema schema;
+    auto scalar = [](std::string name, std::string argument = {}) {
+        graphql::FieldSpec spec{.name = name,
+                                .responseKey = name,
+                                .returnType = "JSON",
+                                .scalar = true};
+        if (!argument.empty())
+        {
+            spec.arguments.push_back({.name = argument,
+                                      .typeName = "Int",
+                                      .required = true});
+        }
+        return spec;
+    };
+    schema.addRootQuery(scalar("users"));
+    schema.addRootQuery(scalar("user", "id"));
+    schema.addRootQuery(scalar("posts"));
+    schema.addRootQuery(scalar("postsByAuthor", "authorId"));
+    return schema;
+}
+
+double nsPerPrepare(BenchExecutor& executor, const std::string& query,
+                    std::size_t rounds)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t r = 0; r < rounds; r++)
+    {
+        if (!executor.prepare(query))
+        {
+            LOG_ERROR("Query failed to prepare: {}", query);
+            return 0;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() /
+           static_cast<double>(rounds);
+}
+
+int main(int argc, char** argv)
+{
+    getLogger().setLogLevel(LogLevel::ERROR);
+    std::string path = argc > 1 ? argv[1] : SAMPLE_QUERIES;
+    std::ifstream file(path);
+    if (!file)
+    {
+        LOG_ERROR("Cannot open {}", path);
+        return 1;
+    }
+    nlohmann::json corpus = nlohmann::json::parse(file);
+
+    auto uncached = std::make_shared<BenchExecutor>(
+        makeSchema(), std::make_shared<NullProvider>());
+    uncached->setQueryCacheCapacity(0);
+    auto cached = std::make_shared<BenchExecutor>(
+        makeSchema(), std::make_shared<NullProvider>());
+
+    constexpr std::size_t rounds = 100000;
+    std::cout << std::format("{:<18} {:>14} {:>14} {:>10}\n", "query",
+                             "parse ns/op", "cached ns/op", "speedup");
+    for (const char* section : {"queries", "examples"})
+    {
+        for (const auto& [name, entry] : corpus[section].items())
+        {
+            std::string query = entry["query"].get<std::string>();
+            auto parseNs = nsPerPrepare(*uncached, query, rounds);
+            auto cachedNs = nsPerPrepare(*cached, query, rounds);
+            std::cout << std::format("{:<18} {:>14.1f} {:>14.1f} {:>9.1f}x\n",
+                                     name, parseNs, cachedNs,
+                                     parseNs / cachedNs);
+        }
+    }
+    return 0;
+}
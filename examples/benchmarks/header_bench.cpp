@@ -0,0 +1,91 @@
+// Measures event-queue header throughput over a local socketpair. The writer
+// pipelines many "\r\n\r\n" terminated headers per write; the reader pulls
+// them either as views into the connection buffer (readFrame + consume) or
+// as copied strings (readUntil).
+#include "logger.hpp"
+#include "socket_streams.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+using namespace NSNAME;
+
+static constexpr auto delim = "\r\n\r\n";
+static constexpr std::size_t headerCount = 1'000'000;
+static constexpr std::size_t headersPerWrite = 64;
+
+using Streamer = TimedStreamer<unix_domain::socket>;
+
+net::awaitable<void> writeHeaders(std::shared_ptr<unix_domain::socket> socket)
+{
+    std::string block;
+    for (std::size_t i = 0; i < headersPerWrite; i++)
+    {
+        block += std::format("FileModified:/var/lib/app/file{:04}{}", i, delim);
+    }
+    for (std::size_t sent = 0; sent < headerCount; sent += headersPerWrite)
+    {
+        co_await net::async_write(*socket, net::buffer(block),
+                                  net::use_awaitable);
+    }
+}
+
+net::awaitable<void> readViews(Streamer streamer, std::size_t& bytes)
+{
+    for (std::size_t i = 0; i < headerCount; i++)
+    {
+        auto [ec, frame] = co_await streamer.readFrame(delim, false);
+        if (ec)
+        {
+            LOG_ERROR("readFrame failed: {}", ec.message());
+            co_return;
+        }
+        bytes += frame.size();
+        streamer.consume(frame.size());
+    }
+}
+
+net::awaitable<void> readCopies(Streamer streamer, std::size_t& bytes)
+{
+    for (std::size_t i = 0; i < headerCount; i++)
+    {
+        auto [ec, header] = co_await streamer.readUntil(delim, false);
+        if (ec)
+        {
+            LOG_ERROR("readUntil failed: {}", ec.message());
+            co_return;
+        }
+        bytes += header.size();
+    }
+}
+
+template <typename Reader>
+void run(const char* name, Reader reader)
+{
+    net::io_context ioc;
+    auto writer = std::make_shared<unix_domain::socket>(ioc);
+    auto reader_socket = std::make_shared<unix_domain::socket>(ioc);
+    net::local::connect_pair(*writer, *reader_socket);
+    Streamer streamer(reader_socket,
+                      std::make_shared<net::steady_timer>(ioc));
+
+    std::size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    net::co_spawn(ioc, writeHeaders(writer), net::detached);
+    net::co_spawn(ioc, reader(streamer, bytes), net::detached);
+    ioc.run();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << std::format("{:>8}: {:>12.0f} headers/s {:>8.1f} MB/s\n", name,
+                             headerCount / elapsed.count(),
+                             bytes / elapsed.count() / 1e6);
+}
+
+int main()
+{
+    getLogger().setLogLevel(LogLevel::ERROR);
+    run("view", readViews);
+    run("copy", readCopies);
+    return 0;
+}
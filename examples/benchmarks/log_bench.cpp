@@ -0,0 +1,122 @@
+// Calling-thread cost of a log line: a disabled LOG_DEBUG with and without
+// the level check ahead of formatting, and an already formatted line written
+// by the synchronous OStreamLogger or queued to the AsyncRingLogger, both
+// appending to a scratch file. The ring is fed in batches it can hold, so
+// the number is the cost of queueing a line, not of dropping it.
+#include "async_logger.hpp"
+#include "logger.hpp"
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+using namespace NSNAME;
+
+static constexpr std::size_t lines = 1'000'000;
+
+template <typename Body>
+double nsPerLine(Body&& body)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < lines; i++)
+    {
+        body(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() /
+           static_cast<double>(lines);
+}
+
+static constexpr auto scratch = "log_bench.out";
+
+// What Logger::log hands the backend for one enabled line.
+template <LogBackend Backend>
+double nsPerEnabledLine(Backend& backend)
+{
+    std::string line = "[Info] redfish_client.hpp:155 request for "
+                       "/redfish/v1/Systems/system took 42 us";
+    return nsPerLine([&](std::size_t) {
+        backend << line;
+        backend.flush(toSystemdLevel(LogLevel::INFO));
+    });
+}
+
+// Queue lines in batches of half the ring and wait for the writer to drain
+// each batch before timing the next. Pushing all lines back to back would
+// outrun the writer, and most pushes would only count a drop.
+template <std::size_t Capacity, std::size_t RecordSize>
+double nsPerQueuedLine(AsyncRingLogger<Capacity, RecordSize>& backend)
+{
+    std::string line = "[Info] redfish_client.hpp:155 request for "
+                       "/redfish/v1/Systems/system took 42 us";
+    std::chrono::steady_clock::duration busy{};
+    for (std::size_t queued = 0; queued < lines;)
+    {
+        auto batch = std::min(Capacity / 2, lines - queued);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < batch; i++)
+        {
+            backend << line;
+            backend.flush(toSystemdLevel(LogLevel::INFO));
+        }
+        busy += std::chrono::steady_clock::now() - start;
+        queued += batch;
+        while (true)
+        {
+            auto stats = backend.stats();
+            if (stats.written + stats.dropped >= queued)
+            {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+    return std::chrono::duration<double, std::nano>(busy).count() /
+           static_cast<double>(lines);
+}
+
+int main()
+{
+    getLogger().setLogLevel(LogLevel::ERROR);
+    std::string target = "/redfish/v1/Systems/system";
+
+    auto formatFirst = nsPerLine([&](std::size_t i) {
+        getLogger().log(std::source_location::current(), LogLevel::DEBUG,
+                        std::format("request {} for {}", i, target));
+    });
+    auto checkFirst = nsPerLine([&](std::size_t i) {
+        LOG_DEBUG("request {} for {}", i, target);
+    });
+    std::cout << std::format("{:<34} {:>10}\n", "disabled LOG_DEBUG", "ns/line");
+    std::cout << std::format("{:<34} {:>10.1f}\n", "  format, then check level",
+                             formatFirst);
+    std::cout << std::format("{:<34} {:>10.1f}\n", "  check level, then format",
+                             checkFirst);
+
+    double syncNs = 0;
+    {
+        std::ofstream file(scratch, std::ios::trunc);
+        OStreamLogger backend(file);
+        syncNs = nsPerEnabledLine(backend);
+    }
+    double asyncNs = 0;
+    AsyncRingLogger<>::Stats stats{};
+    int fd = ::open(scratch, O_WRONLY | O_TRUNC);
+    {
+        AsyncRingLogger<> backend(AsyncRingLogger<>::Sink::Fd, fd);
+        asyncNs = nsPerQueuedLine(backend);
+        stats = backend.stats();
+    }
+    ::close(fd);
+    std::remove(scratch);
+    std::cout << std::format("{:<34} {:>10}\n", "enabled line, backend only", "ns/line");
+    std::cout << std::format("{:<34} {:>10.1f}\n", "  OStreamLogger", syncNs);
+    std::cout << std::format("{:<34} {:>10.1f}  ({} dropped)\n",
+                             "  AsyncRingLogger", asyncNs, stats.dropped);
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Compares route lookup in the trie used by HttpRouter against the previous
+// linear flat_map<request_mapper> dispatch followed by
+// extract_params_from_path, at 10, 100 and 1000 registered routes.
+#include "beastdefs.hpp"
+#include "flat_map.hpp"
+#include "http_target_parser.hpp"
+#include "logger.hpp"
+#include "request_mapper.hpp"
+#include "route_trie.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace NSNAME;
+
+// Redfish-shaped routes: collections, members and member sub-resources.
+std::vector<std::string> makeRoutes(std::size_t count)
+{
+    std::vector<std::string> routes;
+    for (std::size_t i = 0; routes.size() < count; i++)
+    {
+        auto base = std::format("/redfish/v1/Collection{}", i);
+        routes.push_back(base);
+        routes.push_back(base + "/{Id}");
+        routes.push_back(base + "/{Id}/Settings/{SettingId}");
+    }
+    routes.resize(count);
+    return routes;
+}
+
+std::string instantiate(const std::string& route)
+{
+    std::string path;
+    for (auto segment : split(route, '/'))
+    {
+        if (!path.empty() || !segment.empty())
+        {
+            path += '/';
+        }
+        if (!segment.empty() && segment.front() == '{')
+        {
+            path += "member42";
+            continue;
+        }
+        path += segment;
+    }
+    return path;
+}
+
+template <typename Lookup>
+double nsPerLookup(const std::vector<std::string>& paths, std::size_t rounds,
+                   Lookup&& lookup)
+{
+    std::size_t hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t r = 0; r < rounds; r++)
+    {
+        for (const auto& path : paths)
+        {
+            hits += lookup(path);
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if (hits != rounds * paths.size())
+    {
+        LOG_ERROR("Lookup missed {} paths", rounds * paths.size() - hits);
+    }
+    return std::chrono::duration<double, std::nano>(elapsed).count() /
+           static_cast<double>(rounds * paths.size());
+}
+
+int main()
+{
+    getLogger().setLogLevel(LogLevel::ERROR);
+    std::cout << std::format("{:>8} {:>14} {:>14} {:>10}\n", "routes",
+                             "linear ns/op", "trie ns/op", "speedup");
+    for (std::size_t count : {10, 100, 1000})
+    {
+        auto routes = makeRoutes(count);
+
+        flat_map<request_mapper, int> linear;
+        RouteTrie<int> trie;
+        for (std::size_t i = 0; i < routes.size(); i++)
+        {
+            linear[{routes[i], http::verb::get}] = static_cast<int>(i);
+            trie[routes[i]] = static_cast<int>(i);
+        }
+
+        std::vector<std::string> paths;
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<std::size_t> pick(0, routes.size() - 1);
+        for (int i = 0; i < 256; i++)
+        {
+            paths.push_back(instantiate(routes[pick(rng)]));
+        }
+        std::size_t rounds = std::max<std::size_t>(1, 20000 / count);
+
+        auto linearNs = nsPerLookup(paths, rounds, [&](const std::string& p) {
+            http_function func;
+            auto iter = linear.find({p, http::verb::get});
+            if (iter == linear.end())
+            {
+                return false;
+            }
+            extract_params_from_path(func, iter->first.path, p);
+            return true;
+        });
+        auto trieNs = nsPerLookup(paths, rounds, [&](const std::string& p) {
+            http_function func;
+            RouteParams captures;
+            if (trie.match(p, captures) == nullptr)
+            {
+                return false;
+            }
+            for (const auto& [name, value] : captures)
+            {
+                func.params().emplace_back(name, std::string(value));
+            }
+            return true;
+        });
+        std::cout << std::format("{:>8} {:>14.1f} {:>14.1f} {:>9.1f}x\n", count,
+                                 linearNs, trieNs, linearNs / trieNs);
+    }
+    return 0;
+}
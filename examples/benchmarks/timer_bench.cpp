@@ -0,0 +1,179 @@
+// Compares the cost of TimedStreamer timeouts when pushing 8 KB chunks over
+// a socketpair: the per-connection watchdog against the previous scheme that
+// re-armed and cancelled the timer around every write.
+//
+// Heap allocations are counted through the global operator new. System calls
+// made by the reactor are counted by interposing the libc wrappers Asio uses
+// (epoll, timerfd and socket I/O), so the numbers cover both the writer and
+// the reader side.
+#include "logger.hpp"
+#include "socket_streams.hpp"
+
+#include <dlfcn.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <new>
+using namespace NSNAME;
+
+static std::atomic<std::size_t> allocations{0};
+static std::atomic<std::size_t> syscalls{0};
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (void* p = std::malloc(size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+template <typename Fn>
+Fn next(const char* name)
+{
+    return reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+}
+extern "C"
+{
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event* event) noexcept
+{
+    static auto real = next<decltype(&epoll_ctl)>("epoll_ctl");
+    ++syscalls;
+    return real(epfd, op, fd, event);
+}
+int epoll_wait(int epfd, struct epoll_event* events, int max, int timeout)
+{
+    static auto real = next<decltype(&epoll_wait)>("epoll_wait");
+    ++syscalls;
+    return real(epfd, events, max, timeout);
+}
+int timerfd_settime(int fd, int flags, const struct itimerspec* value,
+                    struct itimerspec* old) noexcept
+{
+    static auto real = next<decltype(&timerfd_settime)>("timerfd_settime");
+    ++syscalls;
+    return real(fd, flags, value, old);
+}
+ssize_t sendmsg(int fd, const struct msghdr* msg, int flags)
+{
+    static auto real = next<decltype(&sendmsg)>("sendmsg");
+    ++syscalls;
+    return real(fd, msg, flags);
+}
+ssize_t recvmsg(int fd, struct msghdr* msg, int flags)
+{
+    static auto real = next<decltype(&recvmsg)>("recvmsg");
+    ++syscalls;
+    return real(fd, msg, flags);
+}
+}
+
+static constexpr std::size_t chunkSize = 8192;
+static constexpr std::size_t chunkCount = 100'000;
+
+// TimedStreamer::write as it was before the watchdog: arm, write, cancel.
+struct RearmingWriter
+{
+    std::shared_ptr<unix_domain::socket> socket;
+    std::shared_ptr<net::steady_timer> timer;
+
+    AwaitableResult<std::size_t> write(net::const_buffer data)
+    {
+        timer->expires_after(30s);
+        timer->async_wait([socket = socket](const boost::system::error_code& ec) {
+            if (!ec)
+            {
+                socket->cancel();
+            }
+        });
+        boost::system::error_code ec;
+        auto bytes = co_await socket->async_write_some(
+            data, net::redirect_error(net::use_awaitable, ec));
+        timer->cancel();
+        co_return std::make_pair(ec, bytes);
+    }
+};
+
+template <typename Writer>
+net::awaitable<void> writeChunks(Writer writer)
+{
+    std::vector<char> chunk(chunkSize, 'x');
+    for (std::size_t i = 0; i < chunkCount; i++)
+    {
+        std::size_t sent = 0;
+        while (sent < chunk.size())
+        {
+            auto [ec, bytes] = co_await writer.write(
+                net::buffer(chunk.data() + sent, chunk.size() - sent));
+            if (ec)
+            {
+                LOG_ERROR("write failed: {}", ec.message());
+                co_return;
+            }
+            sent += bytes;
+        }
+    }
+    writer.socket->shutdown(unix_domain::socket::shutdown_send);
+}
+
+net::awaitable<void> drain(std::shared_ptr<unix_domain::socket> socket)
+{
+    std::vector<char> buffer(64 * 1024);
+    boost::system::error_code ec;
+    while (!ec)
+    {
+        co_await socket->async_read_some(
+            net::buffer(buffer), net::redirect_error(net::use_awaitable, ec));
+    }
+}
+
+template <typename MakeWriter>
+void run(const char* name, MakeWriter makeWriter)
+{
+    net::io_context ioc;
+    auto writerSocket = std::make_shared<unix_domain::socket>(ioc);
+    auto readerSocket = std::make_shared<unix_domain::socket>(ioc);
+    net::local::connect_pair(*writerSocket, *readerSocket);
+    auto timer = std::make_shared<net::steady_timer>(ioc);
+
+    auto allocBefore = allocations.load();
+    auto syscallBefore = syscalls.load();
+    auto start = std::chrono::steady_clock::now();
+    net::co_spawn(ioc, writeChunks(makeWriter(writerSocket, timer)),
+                  [timer](std::exception_ptr) { timer->cancel(); });
+    net::co_spawn(ioc, drain(readerSocket), net::detached);
+    ioc.run();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << std::format(
+        "{:>10}: {:>8.2f} allocs/chunk {:>8.2f} syscalls/chunk {:>8.0f} MB/s\n",
+        name, double(allocations - allocBefore) / chunkCount,
+        double(syscalls - syscallBefore) / chunkCount,
+        chunkSize * chunkCount / elapsed.count() / 1e6);
+}
+
+int main()
+{
+    getLogger().setLogLevel(LogLevel::ERROR);
+    run("rearming", [](auto socket, auto timer) {
+        return RearmingWriter{socket, timer};
+    });
+    run("watchdog", [](auto socket, auto timer) {
+        return TimedStreamer<unix_domain::socket>(socket, timer);
+    });
+    return 0;
+}
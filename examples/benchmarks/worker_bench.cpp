@@ -0,0 +1,169 @@
+// Compares WorkerPool task throughput against the previous single-mutex
+// deque pool. Each run submits tiny tasks from one or more producer threads,
+// the way io_context threads hand blocking work to asyncCall, and measures
+// the time until every task has run. Like coroutines awaiting their results,
+// a producer keeps at most `window` tasks outstanding. Heap allocations per
+// task are counted through the global operator new.
+#include "logger.hpp"
+#include "worker.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+using namespace NSNAME;
+
+static std::atomic<std::size_t> allocations{0};
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (void* p = std::malloc(size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// The pool as it was: one deque behind one mutex, notify_all per task.
+struct LegacyWorkerPool
+{
+    std::deque<std::function<void()>> task_queue;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::stop_source stop_source;
+    std::vector<std::jthread> threads;
+
+    explicit LegacyWorkerPool(unsigned num_threads) : threads(num_threads)
+    {
+        for (auto& thread : threads)
+        {
+            thread = std::jthread([this]() {
+                auto token = stop_source.get_token();
+                while (!token.stop_requested())
+                {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        condition.wait(lock, [this, token] {
+                            return !task_queue.empty() ||
+                                   token.stop_requested();
+                        });
+                        if (!token.stop_requested())
+                        {
+                            task = std::move(task_queue.front());
+                            task_queue.pop_front();
+                        }
+                    }
+                    if (!task)
+                        break;
+                    task();
+                }
+            });
+        }
+    }
+    ~LegacyWorkerPool()
+    {
+        stop_source.request_stop();
+        condition.notify_all();
+    }
+    void addTask(std::function<void()>&& task)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        task_queue.emplace_back(std::move(task));
+        condition.notify_all();
+    }
+};
+
+static constexpr std::size_t taskCount = 400'000;
+static constexpr std::size_t window = 256;
+
+// A closure shaped like the one asyncCall submits: a context reference, a
+// shared promise and the user's std::function.
+struct Payload
+{
+    std::atomic<std::size_t>* done;
+    std::shared_ptr<int> promise;
+    std::function<void()> work;
+};
+
+template <typename Pool>
+std::pair<double, double> run(unsigned workers, unsigned producers)
+{
+    std::atomic<std::size_t> done{0};
+    auto promise = std::make_shared<int>(0);
+    std::function<void()> work = [] {};
+    double seconds = 0;
+    std::size_t allocs = 0;
+    {
+        Pool pool(workers);
+        auto allocBefore = allocations.load();
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::jthread> threads;
+            for (unsigned p = 0; p < producers; p++)
+            {
+                threads.emplace_back([&] {
+                    std::atomic<std::size_t> mine{0};
+                    for (std::size_t i = 0; i < taskCount / producers; i++)
+                    {
+                        while (i - mine.load(std::memory_order_relaxed) >=
+                               window)
+                        {
+                            std::this_thread::yield();
+                        }
+                        pool.addTask(
+                            [payload = Payload{&done, promise, work},
+                             &mine]() {
+                                payload.work();
+                                payload.done->fetch_add(
+                                    1, std::memory_order_relaxed);
+                                mine.fetch_add(1, std::memory_order_relaxed);
+                            });
+                    }
+                });
+            }
+        }
+        auto expected = taskCount / producers * producers;
+        while (done.load(std::memory_order_relaxed) < expected)
+        {
+            std::this_thread::yield();
+        }
+        seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+        allocs = allocations - allocBefore;
+    }
+    return {taskCount / seconds, double(allocs) / taskCount};
+}
+
+int main()
+{
+    getLogger().setLogLevel(LogLevel::ERROR);
+    std::cout << std::format("{:>8} {:>10} {:>14} {:>14} {:>12} {:>12}\n",
+                             "workers", "producers", "legacy tasks/s",
+                             "pool tasks/s", "legacy alloc", "pool alloc");
+    for (unsigned workers : {1u, 2u, 4u})
+    {
+        for (unsigned producers : {1u, 4u})
+        {
+            auto [legacyRate, legacyAllocs] =
+                run<LegacyWorkerPool>(workers, producers);
+            auto [poolRate, poolAllocs] = run<WorkerPool>(workers, producers);
+            std::cout << std::format(
+                "{:>8} {:>10} {:>14.0f} {:>14.0f} {:>12.2f} {:>12.2f}\n",
+                workers, producers, legacyRate, poolRate, legacyAllocs,
+                poolAllocs);
+        }
+    }
+    return 0;
+}
@@ -109,6 +109,7 @@ int main(int argc, const char* argv[])
         auto rp = json.value("remote-port", std::string{});
         auto port = json.value("port", std::string{});
         auto maxConnections = json.value("max-connections", 1);
+        auto pipelineWindow = json.value("pipeline-window", 0);
         auto pluginfolder = json.value("plugins-folder", "/usr/bin/plugins");
 
         auto& logger = reactor::getLogger();
@@ -133,6 +134,7 @@ int main(int argc, const char* argv[])
                                std::atoi(port.data()), ssl_server_context);
         EventQueue eventQueue(io_context.get_executor(), acceptor,
                               ssl_client_context, dest, rp, maxConnections);
+        eventQueue.setPipelineWindow(pipelineWindow);
         peventQueue = &eventQueue;
         FileSync fileSync(io_context.get_executor(), eventQueue,
                           json.value("file-sync", nlohmann::json{}));
@@ -1,36 +1,36 @@
 #pragma once
 #include "eventmethods.hpp"
-net::awaitable<boost::system::error_code> sendFile(Streamer streamer,
-                                                   const std::string& filePath)
+// Send fileSize bytes of fd from the start and close fd. On a plain socket
+// the kernel copies the file with TimedStreamer::sendFile. On TLS, which the
+// broker connections use, it goes a file block at a time straight from the
+// reader's buffer: Asio's SSL engine feeds OpenSSL through a memory BIO, so
+// OpenSSL never gets the socket to enable kernel TLS on.
+template <typename FileStreamer>
+net::awaitable<boost::system::error_code> sendFileBlocks(FileStreamer streamer,
+                                                         int fd,
+                                                         off_t fileSize)
 {
-    int fd = ::open(filePath.c_str(), O_RDONLY);
-    if (fd == -1)
+    if constexpr (!SslStream<typename FileStreamer::stream_type>)
     {
-        LOG_ERROR("File: {} open failed for read", filePath);
-        co_return boost::asio::error::operation_aborted;
-    }
-    off_t fileSize = lseek(fd, 0, SEEK_END);
-    if (fileSize == -1)
-    {
-        LOG_ERROR("Failed to get file size: {}", filePath);
-        co_return boost::asio::error::operation_aborted;
+        FileDescriptor file(fd);
+        auto [ec, sent] = co_await streamer.sendFile(
+            fd, 0, static_cast<std::size_t>(fileSize), timeoutneeded);
+        if (ec != boost::system::errc::operation_not_supported)
+        {
+            if (ec)
+            {
+                LOG_ERROR("Failed to send file: {}", ec.message());
+            }
+            co_return ec;
+        }
+        fd = file.release(); // the file system cannot; copy it by blocks
     }
-    lseek(fd, 0, SEEK_SET);
+    ::lseek(fd, 0, SEEK_SET); // the reader starts at the file offset
     AsyncFileReader reader(co_await net::this_coro::executor, fd);
-
-    auto [ec, size] =
-        co_await sendHeader(streamer, std::format("Content-Size:{}", fileSize));
-    if (ec)
-    {
-        LOG_ERROR("Failed to write to stream: {}", ec.message());
-        co_return ec;
-    }
-    std::vector<char> data((fileSize < BUFFER_SIZE) ? fileSize : BUFFER_SIZE);
     off_t sentSofar = 0;
     while (sentSofar < fileSize)
     {
-        auto [ec, bytes] =
-            co_await reader.read(net::buffer(data.data(), data.size()));
+        auto [ec, block] = co_await reader.readBlock();
         if (ec == boost::asio::error::eof)
         {
             break;
@@ -42,18 +42,45 @@ net::awaitable<boost::system::error_code> sendFile(Streamer streamer,
         }
         size_t byteSent = 0;
         std::tie(ec, byteSent) =
-            co_await sendData(streamer, net::buffer(data.data(), bytes));
+            co_await streamer.writeAll(block, timeoutneeded);
         if (ec)
         {
             LOG_ERROR("Failed to write to stream: {}", ec.message());
             co_return ec;
         }
 
-        sentSofar += bytes;
+        sentSofar += static_cast<off_t>(block.size());
         LOG_DEBUG("Remaining: {} to send", fileSize - sentSofar);
     }
     co_return boost::system::error_code{};
 }
+net::awaitable<boost::system::error_code> sendFile(Streamer streamer,
+                                                   const std::string& filePath)
+{
+    int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        LOG_ERROR("File: {} open failed for read", filePath);
+        co_return boost::asio::error::operation_aborted;
+    }
+    FileDescriptor file(fd);
+    off_t fileSize = lseek(fd, 0, SEEK_END);
+    if (fileSize == -1)
+    {
+        LOG_ERROR("Failed to get file size: {}", filePath);
+        co_return boost::asio::error::operation_aborted;
+    }
+    lseek(fd, 0, SEEK_SET);
+
+    auto [ec, size] =
+        co_await sendHeader(streamer, std::format("Content-Size:{}", fileSize));
+    if (ec)
+    {
+        LOG_ERROR("Failed to write to stream: {}", ec.message());
+        co_return ec;
+    }
+    co_return co_await sendFileBlocks(streamer, file.release(), fileSize);
+}
 AwaitableResult<std::string> readFor(Streamer streamer, const auto& headers,
                                      int retryCount = 3)
 {
@@ -166,7 +193,7 @@ net::awaitable<boost::system::error_code> recieveFile(
             recSofar += bytes;
             LOG_DEBUG("Remaining : {} bytes recieved", fileSize - recSofar);
         }
-        co_return boost::system::error_code{};
+        co_return co_await writer.flush();
     }
     else
     {
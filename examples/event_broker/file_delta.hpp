@@ -0,0 +1,723 @@
+#pragma once
+#include "event_file_methods.hpp"
+#include "eventmethods.hpp"
+#include "file_watcher.hpp"
+#include "logger.hpp"
+
+#include <openssl/evp.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// rsync-style delta transfer of a modified file. The receiver sends the
+// signature of its copy, a weak rolling checksum and a strong hash per block;
+// the sender slides a block-sized window over the new contents and answers
+// with copy records for the blocks the receiver already has and literal
+// records for everything else, then the SHA-256 of the new file. On a hash
+// mismatch the receiver asks again and the file is sent in full.
+//
+//   receiver: FetchDelta:<path>, Signature:<block size>:<count>, signature
+//   sender:   Content-Delta:<size>, records..., 'E' <sha256>
+//   receiver: DeltaOk | DeltaRetry (then Content-Size:<size>, file)
+//
+// Numbers in signatures and records are little-endian.
+
+// Files smaller than this are sent whole; a delta would barely be smaller.
+static constexpr std::uint64_t DELTA_MIN_SIZE = 16 * 1024;
+// What the sender may answer a FetchDelta with.
+static const std::array<std::string_view, 2> DELTA_HEADERS{"FileNotFound",
+                                                           "Content-Delta"};
+
+struct BlockSignature
+{
+    static constexpr std::size_t wireSize = 20;
+
+    std::uint32_t weak;
+    std::array<unsigned char, 16> strong; // SHA-256, truncated
+};
+
+struct FileSignature
+{
+    std::uint32_t blockSize{0};
+    std::uint64_t fileSize{0};
+    std::vector<BlockSignature> blocks;
+};
+
+// The rsync rolling checksum: both halves can be updated as the window moves
+// one byte, without looking at the bytes in between.
+class RollingChecksum
+{
+  public:
+    void reset(const char* data, std::size_t size)
+    {
+        a = 0;
+        b = 0;
+        length = static_cast<std::uint32_t>(size);
+        for (std::size_t i = 0; i < size; i++)
+        {
+            auto byte = static_cast<unsigned char>(data[i]);
+            a += byte;
+            b += static_cast<std::uint32_t>(size - i) * byte;
+        }
+    }
+    // Drop out from the front of the window and append in at the back.
+    void roll(char out, char in)
+    {
+        auto outByte = static_cast<unsigned char>(out);
+        a += static_cast<unsigned char>(in) - outByte;
+        b += a - length * outByte;
+    }
+    std::uint32_t digest() const
+    {
+        return (a & 0xffff) | (b << 16);
+    }
+
+  private:
+    std::uint32_t a{0};
+    std::uint32_t b{0};
+    std::uint32_t length{0};
+};
+
+inline std::array<unsigned char, 16> strongHash(const char* data,
+                                                std::size_t size)
+{
+    std::array<unsigned char, EVP_MAX_MD_SIZE> digest{};
+    EVP_Digest(data, size, digest.data(), nullptr, EVP_sha256(), nullptr);
+    std::array<unsigned char, 16> strong{};
+    std::copy_n(digest.begin(), strong.size(), strong.begin());
+    return strong;
+}
+
+// Whole-file SHA-256, fed as the data goes by.
+class FileHash
+{
+  public:
+    static constexpr std::size_t size = 32;
+
+    FileHash() : ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free)
+    {
+        EVP_DigestInit_ex(ctx.get(), EVP_sha256(), nullptr);
+    }
+    void update(net::const_buffer data)
+    {
+        EVP_DigestUpdate(ctx.get(), data.data(), data.size());
+    }
+    std::array<unsigned char, size> final()
+    {
+        std::array<unsigned char, size> digest{};
+        EVP_DigestFinal_ex(ctx.get(), digest.data(), nullptr);
+        return digest;
+    }
+
+  private:
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx;
+};
+
+inline void putLE32(std::string& out, std::uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+// Whole of text as a decimal number; peer data, so anything else is false.
+template <typename Number>
+inline bool parseNumber(std::string_view text, Number& value)
+{
+    auto [ptr, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value);
+    return !text.empty() && ec == std::errc() &&
+           ptr == text.data() + text.size();
+}
+
+inline std::uint32_t getLE32(const unsigned char* in)
+{
+    return in[0] | (in[1] << 8) | (in[2] << 16) |
+           (static_cast<std::uint32_t>(in[3]) << 24);
+}
+
+// Read exactly buffer.size() bytes.
+inline AwaitableResult<size_t> readExact(Streamer streamer,
+                                         net::mutable_buffer buffer)
+{
+    std::size_t total = 0;
+    while (total < buffer.size())
+    {
+        auto [ec, bytes] = co_await readData(streamer, buffer + total);
+        if (ec)
+        {
+            co_return std::make_pair(ec, total);
+        }
+        total += bytes;
+    }
+    co_return std::make_pair(boost::system::error_code{}, total);
+}
+
+// About sqrt(size), as rsync does, to balance signature size against how
+// much a changed byte costs.
+inline std::uint32_t deltaBlockSize(std::uint64_t fileSize)
+{
+    auto root =
+        static_cast<std::uint32_t>(std::sqrt(static_cast<double>(fileSize)));
+    return std::clamp(root & ~511u, 2048u, 65536u);
+}
+
+inline net::awaitable<std::shared_ptr<const FileSignature>> computeSignature(
+    const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        co_return nullptr;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        co_return nullptr;
+    }
+    auto signature = std::make_shared<FileSignature>();
+    signature->fileSize = static_cast<std::uint64_t>(st.st_size);
+    signature->blockSize = deltaBlockSize(signature->fileSize);
+    signature->blocks.reserve(signature->fileSize / signature->blockSize + 1);
+
+    auto executor = co_await net::this_coro::executor;
+    AsyncFileReader reader(executor, fd);
+    std::vector<char> block(signature->blockSize);
+    std::size_t filled = 0;
+    auto addBlock = [&] {
+        RollingChecksum checksum;
+        checksum.reset(block.data(), filled);
+        signature->blocks.push_back(
+            {checksum.digest(), strongHash(block.data(), filled)});
+        filled = 0;
+    };
+    while (true)
+    {
+        auto [ec, data] = co_await reader.readBlock(block.size() - filled);
+        if (ec == net::error::eof)
+        {
+            break;
+        }
+        if (ec)
+        {
+            co_return nullptr;
+        }
+        std::memcpy(block.data() + filled, data.data(), data.size());
+        filled += data.size();
+        if (filled == block.size())
+        {
+            addBlock();
+            // Hashing is CPU work; let other connections run in between
+            co_await net::post(executor, net::use_awaitable);
+        }
+    }
+    if (filled > 0)
+    {
+        addBlock();
+    }
+    co_return signature;
+}
+
+// Signatures of the local copies of synced files, so that a file modified
+// again and again is not read and hashed for every delta. An entry is dropped
+// when inotify reports the file modified or deleted, and is not used if the
+// file's inode, size or mtime no longer match (a rename over it).
+struct SignatureCache
+{
+    explicit SignatureCache(net::any_io_executor io_context) :
+        watcher(io_context)
+    {
+        boost::asio::co_spawn(io_context, watchFileChanges(watcher, *this),
+                              boost::asio::detached);
+    }
+    SignatureCache(const SignatureCache&) = delete;
+    SignatureCache& operator=(const SignatureCache&) = delete;
+
+    // Signature of path, or nullptr when it is missing or too small for a
+    // delta to be worth it.
+    net::awaitable<std::shared_ptr<const FileSignature>> get(
+        const std::string& path)
+    {
+        struct stat st{};
+        if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) ||
+            static_cast<std::uint64_t>(st.st_size) < DELTA_MIN_SIZE)
+        {
+            entries.erase(path);
+            co_return nullptr;
+        }
+        auto it = entries.find(path);
+        if (it != entries.end() && it->second.inode == st.st_ino &&
+            it->second.size == st.st_size &&
+            it->second.mtime == st.st_mtim.tv_sec * 1000000000LL +
+                                    st.st_mtim.tv_nsec)
+        {
+            co_return it->second.signature;
+        }
+        auto signature = co_await computeSignature(path);
+        if (signature)
+        {
+            watcher.addToWatch(path);
+            entries[path] = {st.st_ino, st.st_size,
+                             st.st_mtim.tv_sec * 1000000000LL +
+                                 st.st_mtim.tv_nsec,
+                             signature};
+        }
+        co_return signature;
+    }
+    void invalidate(const std::string& path)
+    {
+        entries.erase(path);
+    }
+    void operator()(const std::string& path, FileWatcher::FileStatus status)
+    {
+        if (status != FileWatcher::FileStatus::created)
+        {
+            invalidate(path);
+        }
+    }
+
+    struct Entry
+    {
+        ino_t inode;
+        off_t size;
+        long long mtime;
+        std::shared_ptr<const FileSignature> signature;
+    };
+    FileWatcher watcher;
+    std::map<std::string, Entry> entries;
+};
+
+inline net::awaitable<boost::system::error_code> sendSignature(
+    Streamer streamer, const FileSignature& signature)
+{
+    auto [ec, size] = co_await sendHeader(
+        streamer, std::format("Signature:{}:{}", signature.blockSize,
+                              signature.blocks.size()));
+    if (ec)
+    {
+        co_return ec;
+    }
+    std::string data;
+    data.reserve(signature.blocks.size() * BlockSignature::wireSize);
+    for (const auto& block : signature.blocks)
+    {
+        putLE32(data, block.weak);
+        data.append(reinterpret_cast<const char*>(block.strong.data()),
+                    block.strong.size());
+    }
+    std::tie(ec, size) =
+        co_await streamer.writeAll(net::buffer(data), timeoutneeded);
+    co_return ec;
+}
+
+inline AwaitableResult<FileSignature> readSignature(Streamer streamer)
+{
+    auto [ec, header] = co_await readHeader(streamer);
+    if (ec)
+    {
+        co_return std::make_pair(ec, FileSignature{});
+    }
+    auto [id, data] = parseEvent(header);
+    auto [blockSizeText, countText] = parseEvent(data);
+    FileSignature signature;
+    std::uint64_t blocks = 0;
+    if (id != "Signature" ||
+        !parseNumber(blockSizeText, signature.blockSize) ||
+        !parseNumber(countText, blocks))
+    {
+        LOG_ERROR("Expected a signature, got: {}", header);
+        co_return std::make_pair(
+            boost::system::error_code{boost::system::errc::protocol_error,
+                                      boost::system::system_category()},
+            std::move(signature));
+    }
+    if (signature.blockSize < 512 || signature.blockSize > 1024 * 1024 ||
+        blocks > (1u << 24))
+    {
+        LOG_ERROR("Unreasonable signature: {}", header);
+        co_return std::make_pair(
+            boost::system::error_code{boost::system::errc::protocol_error,
+                                      boost::system::system_category()},
+            std::move(signature));
+    }
+    std::vector<unsigned char> raw(blocks * BlockSignature::wireSize);
+    std::tie(ec, std::ignore) =
+        co_await readExact(streamer, net::buffer(raw.data(), raw.size()));
+    if (ec)
+    {
+        co_return std::make_pair(ec, std::move(signature));
+    }
+    signature.blocks.resize(blocks);
+    for (std::size_t i = 0; i < blocks; i++)
+    {
+        const unsigned char* in = raw.data() + i * BlockSignature::wireSize;
+        signature.blocks[i].weak = getLE32(in);
+        std::copy_n(in + 4, signature.blocks[i].strong.size(),
+                    signature.blocks[i].strong.begin());
+    }
+    co_return std::make_pair(boost::system::error_code{},
+                             std::move(signature));
+}
+
+// Sender side of FetchDelta: read the receiver's signature and answer with
+// the delta of filePath against it.
+inline net::awaitable<boost::system::error_code> sendDelta(
+    Streamer streamer, const std::string& filePath)
+{
+    auto [ec, signature] = co_await readSignature(streamer);
+    if (ec)
+    {
+        co_return ec;
+    }
+    int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        co_await sendHeader(streamer, makeEvent("FileNotFound", filePath));
+        co_return boost::system::error_code{};
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        co_await sendHeader(streamer, makeEvent("FileNotFound", filePath));
+        co_return boost::system::error_code{};
+    }
+    std::tie(ec, std::ignore) = co_await sendHeader(
+        streamer, std::format("Content-Delta:{}", st.st_size));
+    if (ec)
+    {
+        ::close(fd);
+        co_return ec;
+    }
+
+    std::unordered_multimap<std::uint32_t, std::uint32_t> byWeak;
+    byWeak.reserve(signature.blocks.size());
+    for (std::uint32_t i = 0; i < signature.blocks.size(); i++)
+    {
+        byWeak.emplace(signature.blocks[i].weak, i);
+    }
+    // A short last block was hashed over fewer bytes and so never matches a
+    // full window; the end of the file goes out as literal.
+    const std::size_t blockSize = signature.blockSize;
+
+    auto executor = co_await net::this_coro::executor;
+    AsyncFileReader reader(executor, fd);
+    FileHash fileHash;
+    std::string out;          // records not yet written
+    std::vector<char> window; // file data from literalStart on
+    std::size_t pos = 0;      // start of the block being matched
+    std::size_t literalStart = 0;
+    std::uint32_t copyFirst = 0;
+    std::uint32_t copyCount = 0;
+    std::size_t sentLiteral = 0;
+    std::size_t sentCopied = 0;
+    bool eof = false;
+    RollingChecksum checksum;
+    bool checksumValid = false;
+
+    auto flushCopy = [&] {
+        if (copyCount > 0)
+        {
+            out.push_back('C');
+            putLE32(out, copyFirst);
+            putLE32(out, copyCount);
+            sentCopied += copyCount * blockSize;
+            copyCount = 0;
+        }
+    };
+    auto flushLiteral = [&] {
+        if (pos > literalStart)
+        {
+            out.push_back('L');
+            putLE32(out, static_cast<std::uint32_t>(pos - literalStart));
+            out.append(window.data() + literalStart, pos - literalStart);
+            sentLiteral += pos - literalStart;
+            literalStart = pos;
+        }
+    };
+    auto writeOut = [&]() -> net::awaitable<boost::system::error_code> {
+        auto [ec, size] =
+            co_await streamer.writeAll(net::buffer(out), timeoutneeded);
+        out.clear();
+        co_return ec;
+    };
+
+    while (true)
+    {
+        while (!eof && window.size() - pos < blockSize)
+        {
+            if (literalStart > 4 * blockSize)
+            {
+                window.erase(window.begin(), window.begin() + literalStart);
+                pos -= literalStart;
+                literalStart = 0;
+            }
+            auto [ec, data] = co_await reader.readBlock();
+            if (ec == net::error::eof)
+            {
+                eof = true;
+                break;
+            }
+            if (ec)
+            {
+                co_return ec;
+            }
+            fileHash.update(data);
+            auto bytes = static_cast<const char*>(data.data());
+            window.insert(window.end(), bytes, bytes + data.size());
+            co_await net::post(executor, net::use_awaitable);
+        }
+        if (window.size() - pos < blockSize)
+        {
+            pos = window.size();
+            break;
+        }
+        if (!checksumValid)
+        {
+            checksum.reset(window.data() + pos, blockSize);
+            checksumValid = true;
+        }
+        std::optional<std::uint32_t> match;
+        auto [first, last] = byWeak.equal_range(checksum.digest());
+        if (first != last)
+        {
+            auto strong = strongHash(window.data() + pos, blockSize);
+            for (auto it = first; it != last; ++it)
+            {
+                if (signature.blocks[it->second].strong == strong)
+                {
+                    match = it->second;
+                    break;
+                }
+            }
+        }
+        if (match)
+        {
+            flushLiteral();
+            if (copyCount == 0 || copyFirst + copyCount != *match)
+            {
+                flushCopy();
+                copyFirst = *match;
+            }
+            copyCount++;
+            pos += blockSize;
+            literalStart = pos;
+            checksumValid = false;
+            continue;
+        }
+        flushCopy();
+        if (pos + blockSize < window.size())
+        {
+            checksum.roll(window[pos], window[pos + blockSize]);
+        }
+        else
+        {
+            checksumValid = false;
+        }
+        pos++;
+        if (pos - literalStart >= 64 * 1024)
+        {
+            flushLiteral();
+        }
+        if (out.size() >= 64 * 1024)
+        {
+            if (auto ec = co_await writeOut())
+            {
+                co_return ec;
+            }
+        }
+    }
+    flushCopy();
+    flushLiteral();
+    out.push_back('E');
+    auto digest = fileHash.final();
+    out.append(reinterpret_cast<const char*>(digest.data()), digest.size());
+    if (auto ec = co_await writeOut())
+    {
+        co_return ec;
+    }
+    LOG_INFO("Delta of {}: {} bytes literal, {} bytes copied", filePath,
+             sentLiteral, sentCopied);
+
+    std::string reply;
+    std::tie(ec, reply) = co_await readHeader(streamer);
+    if (ec)
+    {
+        co_return ec;
+    }
+    if (reply == "DeltaRetry")
+    {
+        LOG_WARNING("Delta of {} did not verify, sending it whole", filePath);
+        co_return co_await sendFile(streamer, filePath);
+    }
+    co_return boost::system::error_code{};
+}
+
+// Receiver side of FetchDelta: send the signature of the local copy at
+// root + destPath, rebuild the file from the sender's records and the old
+// copy, and replace the old copy once the result verifies.
+inline net::awaitable<boost::system::error_code> recieveDelta(
+    Streamer streamer, const std::string& root, const std::string& destPath,
+    const FileSignature& signature, SignatureCache& signatures)
+{
+    std::string filePath = root + destPath;
+    if (auto ec = co_await sendSignature(streamer, signature))
+    {
+        co_return ec;
+    }
+    auto [ec, header] = co_await readFor(streamer, DELTA_HEADERS);
+    if (ec)
+    {
+        co_return ec;
+    }
+    auto [id, data] = parseEvent(header);
+    if (id != "Content-Delta")
+    {
+        LOG_ERROR("File not found: {}", filePath);
+        co_return boost::system::error_code{};
+    }
+
+    int oldFd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    std::string tempPath = filePath + ".XXXXXX";
+    int tempFd = ::mkostemp(tempPath.data(), O_CLOEXEC);
+    if (oldFd == -1 || tempFd == -1)
+    {
+        LOG_ERROR("File: {} open failed for delta", filePath);
+        if (oldFd != -1)
+        {
+            ::close(oldFd);
+        }
+        if (tempFd != -1)
+        {
+            ::close(tempFd);
+            ::unlink(tempPath.c_str());
+        }
+        co_return boost::asio::error::operation_aborted;
+    }
+    struct stat st{};
+    if (::fstat(oldFd, &st) == 0)
+    {
+        ::fchmod(tempFd, st.st_mode & 07777);
+    }
+    auto executor = co_await net::this_coro::executor;
+    AsyncFileReader oldFile(executor, oldFd);
+    FileHash fileHash;
+    std::array<unsigned char, FileHash::size> expected{};
+    bool valid = true;
+    {
+        AsyncFileWriter writer(executor, tempFd);
+        auto write = [&](net::const_buffer data)
+            -> net::awaitable<boost::system::error_code> {
+            fileHash.update(data);
+            co_return co_await writer.write(data);
+        };
+        std::vector<char> buffer(BUFFER_SIZE);
+        while (!ec)
+        {
+            std::array<unsigned char, 9> record{};
+            std::tie(ec, std::ignore) =
+                co_await readExact(streamer, net::buffer(record.data(), 1));
+            if (ec || record[0] == 'E')
+            {
+                break;
+            }
+            if (record[0] == 'L')
+            {
+                std::tie(ec, std::ignore) = co_await readExact(
+                    streamer, net::buffer(record.data() + 1, 4));
+                std::size_t remaining = ec ? 0 : getLE32(record.data() + 1);
+                while (!ec && remaining > 0)
+                {
+                    auto chunk = std::min(remaining, buffer.size());
+                    std::tie(ec, std::ignore) = co_await readExact(
+                        streamer, net::buffer(buffer.data(), chunk));
+                    if (!ec)
+                    {
+                        ec = co_await write(net::buffer(buffer.data(), chunk));
+                    }
+                    remaining -= chunk;
+                }
+            }
+            else if (record[0] == 'C')
+            {
+                std::tie(ec, std::ignore) = co_await readExact(
+                    streamer, net::buffer(record.data() + 1, 8));
+                std::uint64_t first = getLE32(record.data() + 1);
+                std::uint64_t count = getLE32(record.data() + 5);
+                if (ec || first + count > signature.blocks.size())
+                {
+                    ec = ec ? ec
+                            : boost::system::error_code{
+                                  boost::system::errc::protocol_error,
+                                  boost::system::system_category()};
+                    break;
+                }
+                co_await oldFile.seek(first * signature.blockSize);
+                auto remaining = std::min(count * signature.blockSize,
+                                          signature.fileSize -
+                                              first * signature.blockSize);
+                while (!ec && remaining > 0)
+                {
+                    auto [readEc, block] = co_await oldFile.readBlock(
+                        static_cast<std::size_t>(remaining));
+                    if (readEc)
+                    {
+                        // The old copy changed under us; the hash will tell
+                        valid = false;
+                        break;
+                    }
+                    ec = co_await write(block);
+                    remaining -= block.size();
+                }
+            }
+            else
+            {
+                LOG_ERROR("Unknown delta record {}", record[0]);
+                ec = boost::system::error_code{
+                    boost::system::errc::protocol_error,
+                    boost::system::system_category()};
+            }
+        }
+        if (!ec)
+        {
+            std::tie(ec, std::ignore) = co_await readExact(
+                streamer, net::buffer(expected.data(), expected.size()));
+        }
+        if (!ec)
+        {
+            ec = co_await writer.flush();
+        }
+    }
+    if (ec)
+    {
+        LOG_ERROR("Delta of {} failed: {}", filePath, ec.message());
+        ::unlink(tempPath.c_str());
+        co_return ec;
+    }
+    if (!valid || fileHash.final() != expected)
+    {
+        ::unlink(tempPath.c_str());
+        co_await sendHeader(streamer, "DeltaRetry");
+        co_return co_await recieveFile(streamer, root, destPath);
+    }
+    if (::rename(tempPath.c_str(), filePath.c_str()) != 0)
+    {
+        LOG_ERROR("Failed to replace {}: {}", filePath, strerror(errno));
+        ::unlink(tempPath.c_str());
+        co_return boost::asio::error::operation_aborted;
+    }
+    signatures.invalidate(filePath);
+    auto [sendEc, size] = co_await sendHeader(streamer, "DeltaOk");
+    co_return sendEc;
+}
@@ -2,13 +2,14 @@
 #include "eventmethods.hpp"
 #include "event_file_methods.hpp"
 #include "eventqueue.hpp"
+#include "file_delta.hpp"
 #include "file_watcher.hpp"
 #include "logger.hpp"
 struct FileSync
 {
     FileSync(net::any_io_executor io_context, EventQueue& eventQueue,
              const nlohmann::json& json) :
-        watcher(io_context), eventQueue(eventQueue)
+        watcher(io_context), eventQueue(eventQueue), signatures(io_context)
     {
         eventQueue.addEventProvider(
             "FileModified",
@@ -49,6 +50,9 @@ struct FileSync
         boost::asio::co_spawn(io_context, watchFileChanges(watcher, *this),
                               boost::asio::detached);
         root = json.value("root", std::string{});
+        // A peer that predates FetchDelta ignores it and never answers, so
+        // deltas are only asked for when the config says the peer has them.
+        delta = json.value("delta", false);
         for (std::string path : json["paths"])
         {
             addPath(path);
@@ -66,11 +70,9 @@ struct FileSync
                 break;
             case FileWatcher::FileStatus::modified:
             {
-                auto event = makeEvent("FileModified", path);
-                if (!eventQueue.eventExists(event))
-                {
-                    eventQueue.addEvent(event);
-                }
+                // The peer fetches the file when it handles the event, so
+                // one pending FileModified per path is enough.
+                eventQueue.replaceEvent(makeEvent("FileModified", path));
             }
 
             break;
@@ -89,6 +91,10 @@ struct FileSync
         {
             co_return co_await sendFile(streamer, path);
         }
+        if (id == "FetchDelta")
+        {
+            co_return co_await sendDelta(streamer, path);
+        }
         if (id == "FetchArchive")
         {
             std::string archpath = "/tmp/.archive/";
@@ -110,14 +116,31 @@ struct FileSync
             co_await sendHeader(streamer, makeEvent("FileNotFound", path));
             co_return boost::system::error_code{};
         }
+        // A request this side does not know still gets an answer, one every
+        // receiver reads, instead of leaving the peer waiting for one.
+        LOG_ERROR("Unknown fetch request: {}", event);
+        co_await sendHeader(streamer, makeEvent("FileNotFound", path));
         co_return boost::system::error_code{};
     }
     net::awaitable<boost::system::error_code> fileConsumer(
-        Streamer streamer, const std::string& event) const
+        Streamer streamer, const std::string& event)
     {
         auto [id, data] = parseEvent(event);
         if (id == "FileModified")
         {
+            // With an older copy here, only what changed has to come over
+            std::shared_ptr<const FileSignature> signature;
+            if (delta)
+            {
+                signature = co_await signatures.get(root + data);
+            }
+            if (signature)
+            {
+                co_await sendHeader(streamer,
+                                    std::format("FetchDelta:{}", data));
+                co_return co_await recieveDelta(streamer, root, data,
+                                                *signature, signatures);
+            }
             co_await sendHeader(streamer, std::format("Fetch:{}", data));
             co_return co_await recieveFile(streamer, root, data);
         }
@@ -154,5 +177,7 @@ struct FileSync
     ~FileSync() {}
     FileWatcher watcher;
     EventQueue& eventQueue;
+    SignatureCache signatures;
     std::string root;
+    bool delta{false};
 };
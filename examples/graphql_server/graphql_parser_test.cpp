@@ -1,4 +1,5 @@
 #include "graphql/parser.hpp"
+#include "graphql/typed_executor.hpp"
 #include "graphql/util.hpp"
 
 #include <iostream>
@@ -172,6 +173,130 @@ void testInvalidSyntax()
     expect(!error.empty(), "Expected validation error message");
 }
 
+// Canonical text of query after fragment expansion, as prepare() keys it.
+std::string canonical(const std::string& query)
+{
+    Operation operation = Parser::parse(query);
+    expandFragments(operation);
+    return canonicalText(operation);
+}
+
+// Layout, argument order and operation name do not change the key.
+void testCanonicalTextIgnoresLayout()
+{
+    std::string key =
+        canonical("query A { system(id: \"1\", name: \"x\") { id name } }");
+
+    expect(canonical("query B{system(name:\"x\" ,id:\"1\"){\n id\n name\n}}") ==
+               key,
+           "Expected whitespace and argument order to be ignored");
+    expect(canonical("{ system(id: \"1\", name: \"x\") { id name } }") == key,
+           "Expected operation name to be ignored");
+    expect(canonical("{ system(id: \"2\", name: \"x\") { id name } }") != key,
+           "Expected argument values to change the key");
+    expect(canonical("subscription { system(id: \"1\", name: \"x\")"
+                     " { id name } }") != key,
+           "Expected operation type to change the key");
+}
+
+// Aliases shape the response, so they are part of the key; fragments are
+// expanded first, so a spread keys like the fields written out.
+void testCanonicalTextAliasesAndFragments()
+{
+    std::string key = canonical("{ main: system(id: \"1\") { id } }");
+
+    expect(canonical("query { main : system(id: \"1\") { id } }") == key,
+           "Expected the same alias to give the same key");
+    expect(canonical("{ other: system(id: \"1\") { id } }") != key,
+           "Expected a different alias to change the key");
+    expect(canonical("{ system(id: \"1\") { id } }") != key,
+           "Expected a missing alias to change the key");
+    expect(canonical("{ system(id: \"1\") { ...SystemFields } }"
+                     " fragment SystemFields on System { id name }") ==
+               canonical("{ system(id: \"1\") { id name } }"),
+           "Expected a named fragment to key like its fields");
+    expect(canonical("{ system(id: \"1\") { ... on System { id name } } }") ==
+               canonical("{ system(id: \"1\") { id name } }"),
+           "Expected an inline fragment to key like its fields");
+}
+
+// A $variable anywhere in an argument value, including inside lists and
+// input objects, means the value is only known at execution.
+void testReferencesVariables()
+{
+    Operation operation = Parser::parse(
+        "query($id: String) { a(id: $id) { id } b(ids: [\"x\", $id]) { id }"
+        " c(filter: {name: $id}) { id } d(id: \"x\", ids: [1, 2]) { id } }");
+
+    const auto& selections = operation.selections;
+    expect(referencesVariables(selections[0].arguments[0].value.value),
+           "Expected a variable argument to be detected");
+    expect(referencesVariables(selections[1].arguments[0].value.value),
+           "Expected a variable inside a list to be detected");
+    expect(referencesVariables(selections[2].arguments[0].value.value),
+           "Expected a variable inside an object to be detected");
+    expect(!referencesVariables(selections[3].arguments[0].value.value) &&
+               !referencesVariables(selections[3].arguments[1].value.value),
+           "Expected literal arguments not to reference variables");
+}
+
+struct NullProvider
+{
+    boost::asio::awaitable<Result<nlohmann::json>> get(std::string)
+    {
+        co_return std::unexpected("not used");
+    }
+    boost::asio::awaitable<Result<nlohmann::json>> getFresh(std::string)
+    {
+        co_return std::unexpected("not used");
+    }
+};
+
+class PlanExecutor : public TypedExecutor<NullProvider>
+{
+  public:
+    using TypedExecutor<NullProvider>::TypedExecutor;
+
+  protected:
+    boost::asio::awaitable<Result<nlohmann::json>> resolveRootField(
+        const FieldSelection&, const FieldSpec&, ExecutionContext&) override
+    {
+        co_return std::unexpected("not used");
+    }
+};
+
+// prepare() expands the Redfish path of literal arguments once; a $variable
+// argument leaves the field to be expanded when it executes.
+void testVariableArgumentSkipsPlannedTarget()
+{
+    TypedSchema schema;
+    ObjectSpec system{.name = "System"};
+    system.fields["id"] = FieldSpec{
+        .name = "id", .responseKey = "Id", .returnType = "String",
+        .scalar = true};
+    schema.addObject(std::move(system));
+    schema.addRootQuery(FieldSpec{
+        .name = "system",
+        .returnType = "System",
+        .arguments = {{.name = "id", .typeName = "String"}},
+        .redfishPath = "/redfish/v1/Systems/{id}"});
+    PlanExecutor executor(std::move(schema), std::make_shared<NullProvider>());
+
+    auto literal = executor.prepare("{ system(id: \"1\") { id } }");
+    expect(literal.has_value(), "Expected literal query to prepare");
+    const auto& targets = (*literal)->targets;
+    auto target = targets.find(&(*literal)->operation.selections[0]);
+    expect(target != targets.end() &&
+               target->second == "/redfish/v1/Systems/1",
+           "Expected literal argument to plan its Redfish target");
+
+    auto variable = executor.prepare(
+        "query($id: String) { system(id: $id) { id } }");
+    expect(variable.has_value(), "Expected variable query to prepare");
+    expect((*variable)->targets.empty(),
+           "Expected variable argument to leave the target unplanned");
+}
+
 } // namespace
 
 int main()
@@ -186,6 +311,10 @@ int main()
         testInlineFragmentExpansion();
         testCircularFragmentDetection();
         testInvalidSyntax();
+        testCanonicalTextIgnoresLayout();
+        testCanonicalTextAliasesAndFragments();
+        testReferencesVariables();
+        testVariableArgumentSkipsPlannedTarget();
     }
     catch (const std::exception& e)
     {
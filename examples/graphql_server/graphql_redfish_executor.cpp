@@ -6,18 +6,18 @@ namespace NSNAME
 boost::asio::awaitable<NSNAME::graphql::Result<nlohmann::json>>
     RedfishGraphQLExecutor::resolveRootField(
         const graphql::FieldSelection& selection,
-        const graphql::FieldSpec& fieldSpec, const nlohmann::json& variables)
+        const graphql::FieldSpec& fieldSpec, ExecutionContext& context)
 {
-    co_return co_await resolveByPath(selection, fieldSpec, variables,
+    co_return co_await resolveByPath(selection, fieldSpec, context,
                                      /*fresh=*/false);
 }
 
 boost::asio::awaitable<NSNAME::graphql::Result<nlohmann::json>>
     RedfishGraphQLExecutor::resolveSubscriptionField(
         const graphql::FieldSelection& selection,
-        const graphql::FieldSpec& fieldSpec, const nlohmann::json& variables)
+        const graphql::FieldSpec& fieldSpec, ExecutionContext& context)
 {
-    co_return co_await resolveByPath(selection, fieldSpec, variables,
+    co_return co_await resolveByPath(selection, fieldSpec, context,
                                      /*fresh=*/true);
 }
 
@@ -23,12 +23,12 @@ class RedfishGraphQLExecutor : public graphql::TypedExecutor<RedfishProvider>
     boost::asio::awaitable<NSNAME::graphql::Result<nlohmann::json>>
         resolveRootField(const graphql::FieldSelection& selection,
                          const graphql::FieldSpec& fieldSpec,
-                         const nlohmann::json& variables) override;
+                         ExecutionContext& context) override;
 
     boost::asio::awaitable<NSNAME::graphql::Result<nlohmann::json>>
         resolveSubscriptionField(const graphql::FieldSelection& selection,
                                  const graphql::FieldSpec& fieldSpec,
-                                 const nlohmann::json& variables) override;
+                                 ExecutionContext& context) override;
 };
 
 } // namespace NSNAME
@@ -7,7 +7,7 @@ HttpRedfishProvider::HttpRedfishProvider(boost::asio::io_context& io,
                                          const RedfishProviderConfig& config) :
     io(io),
     sslContext(boost::asio::ssl::context::tlsv12_client),
-    client(io, sslContext)
+    client(io, sslContext), config(config)
 {
     sslContext.set_default_verify_paths();
     sslContext.set_verify_mode(boost::asio::ssl::verify_none);
@@ -30,53 +30,164 @@ boost::asio::awaitable<NSNAME::graphql::Result<nlohmann::json>>
     HttpRedfishProvider::get(const std::string& target)
 {
     auto cached = cache.find(target);
-    if (cached != cache.end())
+    if (cached != cache.end() && Clock::now() < cached->second.expires)
     {
-        co_return cached->second;
+        stats.hits++;
+        lru.splice(lru.begin(), lru, cached->second.lruPos);
+        co_return cached->second.value;
     }
+    co_return co_await fetch(target);
+}
 
-    RedfishClient::Request request;
-    request.withMethod(http::verb::get).withTarget(target).witKeepAlive(false);
+boost::asio::awaitable<NSNAME::graphql::Result<nlohmann::json>>
+    HttpRedfishProvider::getFresh(const std::string& target)
+{
+    co_return co_await fetch(target);
+}
 
-    auto [ec, response] = co_await client.execute(request);
-    if (ec)
+// Single flight: only the first caller for a target talks to the server.
+boost::asio::awaitable<HttpRedfishProvider::Payload>
+    HttpRedfishProvider::fetch(const std::string& target)
+{
+    if (auto it = inflight.find(target); it != inflight.end())
     {
-        co_return std::unexpected("Failed Redfish request for '" + target +
-                                  "': " + ec.message());
+        stats.coalesced++;
+        auto flight = it->second;
+        boost::system::error_code ec;
+        co_await flight->done.async_wait(
+            boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        if (flight->result)
+        {
+            co_return *flight->result;
+        }
+        co_return std::unexpected("Request for '" + target +
+                                  "' was abandoned");
     }
 
-    nlohmann::json parsed =
-        nlohmann::json::parse(response.body(), nullptr, false);
-    if (parsed.is_discarded())
+    stats.misses++;
+    auto flight = std::make_shared<Flight>(io);
+    inflight.emplace(target, flight);
+    FlightGuard guard{*this, target, flight};
+    Payload result = co_await request(target);
+    flight->result = result;
+    co_return result;
+}
+
+boost::asio::awaitable<HttpRedfishProvider::Payload>
+    HttpRedfishProvider::request(const std::string& target)
+{
+    // Revalidate a cached copy with its ETag first; should the copy be
+    // evicted while the request is out, ask once more without it.
+    for (bool conditional = true;; conditional = false)
     {
-        co_return std::unexpected("Invalid JSON response for '" + target + "'");
-    }
+        RedfishClient::Request request;
+        request.withMethod(http::verb::get).withTarget(target);
+        std::string etag;
+        if (auto it = cache.find(target); conditional && it != cache.end())
+        {
+            etag = it->second.etag;
+        }
+        if (!etag.empty())
+        {
+            request.headers["If-None-Match"] = etag;
+        }
+
+        auto [ec, response] = co_await client.execute(request);
+        if (ec)
+        {
+            co_return std::unexpected("Failed Redfish request for '" + target +
+                                      "': " + ec.message());
+        }
 
-    cache.emplace(target, parsed);
-    co_return parsed;
+        if (response.result() == http::status::not_modified && !etag.empty())
+        {
+            auto it = cache.find(target);
+            if (it == cache.end() || it->second.etag != etag)
+            {
+                continue;
+            }
+            stats.revalidated++;
+            it->second.expires = Clock::now() + ttlFor(target);
+            lru.splice(lru.begin(), lru, it->second.lruPos);
+            co_return it->second.value;
+        }
+
+        nlohmann::json parsed =
+            nlohmann::json::parse(response.body(), nullptr, false);
+        if (parsed.is_discarded())
+        {
+            co_return std::unexpected("Invalid JSON response for '" + target +
+                                      "'");
+        }
+
+        if (response.result() == http::status::ok)
+        {
+            store(target, parsed, std::string(response[http::field::etag]),
+                  response.body().size());
+        }
+        co_return parsed;
+    }
 }
 
-boost::asio::awaitable<NSNAME::graphql::Result<nlohmann::json>>
-    HttpRedfishProvider::getFresh(const std::string& target)
+void HttpRedfishProvider::store(const std::string& target,
+                                nlohmann::json value, std::string etag,
+                                std::size_t size)
 {
-    RedfishClient::Request request;
-    request.withMethod(http::verb::get).withTarget(target).witKeepAlive(false);
-
-    auto [ec, response] = co_await client.execute(request);
-    if (ec)
+    if (auto it = cache.find(target); it != cache.end())
+    {
+        evict(it);
+    }
+    if (size > config.maxCacheBytes)
+    {
+        return;
+    }
+    lru.push_front(target);
+    cache.emplace(target, CacheEntry{std::move(value), std::move(etag),
+                                     Clock::now() + ttlFor(target), size,
+                                     lru.begin()});
+    cacheBytes += size;
+    while (cacheBytes > config.maxCacheBytes)
     {
-        co_return std::unexpected("Failed Redfish request for '" + target +
-                                  "': " + ec.message());
+        stats.evictions++;
+        evict(cache.find(lru.back()));
     }
+}
+
+void HttpRedfishProvider::evict(
+    std::unordered_map<std::string, CacheEntry>::iterator it)
+{
+    cacheBytes -= it->second.size;
+    lru.erase(it->second.lruPos);
+    cache.erase(it);
+}
 
-    nlohmann::json parsed =
-        nlohmann::json::parse(response.body(), nullptr, false);
-    if (parsed.is_discarded())
+std::chrono::seconds
+    HttpRedfishProvider::ttlFor(const std::string& target) const
+{
+    std::chrono::seconds ttl = config.cacheTtl;
+    std::size_t longest = 0;
+    for (const auto& [prefix, prefixTtl] : config.resourceTtls)
     {
-        co_return std::unexpected("Invalid JSON response for '" + target + "'");
+        if (prefix.size() > longest && target.starts_with(prefix))
+        {
+            ttl = prefixTtl;
+            longest = prefix.size();
+        }
     }
+    return ttl;
+}
 
-    co_return parsed;
+nlohmann::json HttpRedfishProvider::cacheStats() const
+{
+    return {{"hits", stats.hits},
+            {"misses", stats.misses},
+            {"coalesced", stats.coalesced},
+            {"revalidated", stats.revalidated},
+            {"evictions", stats.evictions},
+            {"in_flight", inflight.size()},
+            {"entries", cache.size()},
+            {"bytes", cacheBytes},
+            {"max_bytes", config.maxCacheBytes}};
 }
 
 } // namespace NSNAME
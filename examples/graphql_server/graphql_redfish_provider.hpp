@@ -7,7 +7,11 @@
 #include <boost/asio/ssl/context.hpp>
 #include <nlohmann/json.hpp>
 
+#include <chrono>
+#include <list>
+#include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 
@@ -25,6 +29,15 @@ struct RedfishProviderConfig
     // mTLS client certificate/key paths (optional when basic-auth is used)
     std::string clientCertFile;
     std::string clientKeyFile;
+    // How long get() serves a cached resource before revalidating it. The
+    // longest matching prefix in resourceTtls overrides cacheTtl, e.g. to
+    // expire fast-changing sensor readings sooner than inventory.
+    std::chrono::seconds cacheTtl{30};
+    std::map<std::string, std::chrono::seconds> resourceTtls{
+        {"/redfish/v1/Chassis/", std::chrono::seconds(5)},
+        {"/redfish/v1/Systems/", std::chrono::seconds(10)}};
+    // Bound on the cached response bodies; least recently used go first.
+    std::size_t maxCacheBytes{8 * 1024 * 1024};
 };
 
 class RedfishProvider
@@ -47,15 +60,77 @@ class HttpRedfishProvider : public RedfishProvider
     boost::asio::awaitable<NSNAME::graphql::Result<nlohmann::json>> get(
         const std::string& target) override;
 
-    // getFresh bypasses the cache — used by subscriptions to get live data
+    // getFresh always asks the target, so subscriptions see live data, but
+    // concurrent callers share one request and an unchanged resource is
+    // revalidated by ETag rather than sent again.
     boost::asio::awaitable<NSNAME::graphql::Result<nlohmann::json>> getFresh(
         const std::string& target) override;
 
+    // Cache hit/miss/coalesced counters and current size, as JSON.
+    nlohmann::json cacheStats() const;
+
   private:
+    using Clock = std::chrono::steady_clock;
+    using Payload = NSNAME::graphql::Result<nlohmann::json>;
+
+    struct CacheEntry
+    {
+        nlohmann::json value;
+        std::string etag;
+        Clock::time_point expires;
+        std::size_t size{0};
+        std::list<std::string>::iterator lruPos;
+    };
+    // A fetch in progress; callers asking for the same target meanwhile wait
+    // on done and share its result.
+    struct Flight
+    {
+        explicit Flight(boost::asio::io_context& io) : done(io)
+        {
+            done.expires_at(Clock::time_point::max());
+        }
+        boost::asio::steady_timer done;
+        std::optional<Payload> result;
+    };
+    // Ends a flight however its request finishes, throwing included, so that
+    // waiters wake up and the target can be fetched again.
+    struct FlightGuard
+    {
+        HttpRedfishProvider& provider;
+        const std::string& target;
+        std::shared_ptr<Flight> flight;
+
+        ~FlightGuard()
+        {
+            provider.inflight.erase(target);
+            flight->done.cancel();
+        }
+    };
+    struct Stats
+    {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        uint64_t coalesced{0};
+        uint64_t revalidated{0};
+        uint64_t evictions{0};
+    };
+
+    boost::asio::awaitable<Payload> fetch(const std::string& target);
+    boost::asio::awaitable<Payload> request(const std::string& target);
+    void store(const std::string& target, nlohmann::json value,
+               std::string etag, std::size_t size);
+    void evict(std::unordered_map<std::string, CacheEntry>::iterator it);
+    std::chrono::seconds ttlFor(const std::string& target) const;
+
     boost::asio::io_context& io;
     boost::asio::ssl::context sslContext;
     RedfishClient client;
-    std::unordered_map<std::string, nlohmann::json> cache;
+    RedfishProviderConfig config;
+    std::unordered_map<std::string, CacheEntry> cache;
+    std::list<std::string> lru; // most recently used first
+    std::size_t cacheBytes{0};
+    std::unordered_map<std::string, std::shared_ptr<Flight>> inflight;
+    Stats stats;
 };
 
 } // namespace NSNAME
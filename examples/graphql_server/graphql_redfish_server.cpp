@@ -240,9 +240,20 @@ std::expected<void, std::string> run(int argc, const char* argv[])
                                          req.version());
         });
 
+    router.add_get_handler(
+        "/graphql/cache/stats",
+        [provider, executor](Request& req,
+                             const http_function& params) -> Response {
+            nlohmann::json stats = provider->cacheStats();
+            stats["queries"] = executor->getQueryCacheStats();
+            return make_success_response(stats, http::status::ok,
+                                         req.version());
+        });
+
     // SSE subscription endpoint
     // GET /graphql/subscribe?query=subscription{systemStatus(id:"1"){...}}
     // Optional: &interval=5  (poll interval in seconds, default 5)
+    //           &delta=true (after the first event, send JSON Patch changes)
     router.add_sse_handler(
         "/graphql/subscribe",
         [executor](Request& req, const http_function& params,
@@ -250,6 +261,9 @@ std::expected<void, std::string> run(int argc, const char* argv[])
             // parse_function already split and URL-decoded the query string
             std::string query = params["query"];
             std::string intervalStr = params["interval"];
+            auto mode = params["delta"] == "true"
+                            ? RedfishGraphQLExecutor::SubscriptionMode::Delta
+                            : RedfishGraphQLExecutor::SubscriptionMode::Snapshot;
 
             if (query.empty())
             {
@@ -273,12 +287,13 @@ std::expected<void, std::string> run(int argc, const char* argv[])
 
             co_await executor->executeSubscription(
                 query, nlohmann::json::object(), interval,
-                [&writer](nlohmann::json event) -> net::awaitable<bool> {
+                [&writer](const nlohmann::json& event) -> net::awaitable<bool> {
                     // Serialize the event and push it to the SSE stream.
                     // writer.write returns false when the client has gone.
                     bool ok = co_await writer.write(event.dump());
                     co_return ok;
-                });
+                },
+                mode);
         });
 
     TcpStreamType acceptor(ioContext.get_executor(), serverPort, sslContext);
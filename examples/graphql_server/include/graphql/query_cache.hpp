@@ -0,0 +1,117 @@
+#pragma once
+
+#include "graphql/ast.hpp"
+#include "graphql/typed_schema.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace NSNAME::graphql
+{
+
+// An operation that has been parsed, fragment-expanded and validated, along
+// with the schema lookups its execution would otherwise repeat every time.
+struct PreparedOperation
+{
+    Operation operation;
+    // canonicalText(operation), which identifies equivalent subscriptions.
+    std::string canonical;
+    nlohmann::json defaultVariables = nlohmann::json::object();
+    // Root field spec of each of operation.selections, by index.
+    std::vector<const FieldSpec*> rootFields;
+    // Expanded redfishPath of the root fields whose arguments are literals.
+    std::unordered_map<const FieldSelection*, std::string> targets;
+};
+
+// Least recently used map from query text to its PreparedOperation. Entries
+// are immutable and shared, so an execution keeps its operation alive even
+// if the cache evicts it meanwhile.
+class QueryCache
+{
+  public:
+    explicit QueryCache(std::size_t capacity = 256) : capacity(capacity) {}
+
+    std::shared_ptr<const PreparedOperation> find(const std::string& query)
+    {
+        auto it = index.find(query);
+        if (it == index.end())
+        {
+            misses++;
+            return nullptr;
+        }
+        hits++;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    void insert(const std::string& query,
+                std::shared_ptr<const PreparedOperation> prepared)
+    {
+        if (capacity == 0)
+        {
+            return;
+        }
+        if (auto it = index.find(query); it != index.end())
+        {
+            it->second->second = std::move(prepared);
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        entries.emplace_front(query, std::move(prepared));
+        index.emplace(entries.front().first, entries.begin());
+        shrink();
+    }
+
+    void setCapacity(std::size_t count)
+    {
+        capacity = count;
+        shrink();
+    }
+
+    void clear()
+    {
+        index.clear();
+        entries.clear();
+    }
+
+    nlohmann::json stats() const
+    {
+        return {{"hits", hits},
+                {"misses", misses},
+                {"evictions", evictions},
+                {"entries", entries.size()},
+                {"capacity", capacity}};
+    }
+
+  private:
+    using Entry =
+        std::pair<std::string, std::shared_ptr<const PreparedOperation>>;
+
+    void shrink()
+    {
+        while (entries.size() > capacity)
+        {
+            index.erase(entries.back().first);
+            entries.pop_back();
+            evictions++;
+        }
+    }
+
+    std::size_t capacity;
+    std::list<Entry> entries; // most recently used first
+    // Keys view the query text held by the list node.
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t evictions{0};
+};
+
+} // namespace NSNAME::graphql
@@ -2,18 +2,24 @@
 
 #include "graphql/error.hpp"
 #include "graphql/parser.hpp"
+#include "graphql/query_cache.hpp"
 #include "graphql/typed_schema.hpp"
 #include "graphql/util.hpp"
+#include "when_all.hpp"
 
 #include <boost/asio.hpp>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <utility>
 
 namespace NSNAME::graphql
 {
@@ -26,6 +32,64 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
         schema(std::move(schema)), provider(std::move(provider))
     {}
 
+    // How many provider fetches one execution has in flight at a time,
+    // across all of its fields and collection members; 0 means no limit.
+    void setMaxConcurrency(std::size_t count)
+    {
+        maxConcurrency = count;
+    }
+
+    // How many distinct query texts keep their PreparedOperation; 0 turns
+    // the cache off.
+    void setQueryCacheCapacity(std::size_t count)
+    {
+        queryCache.setCapacity(count);
+    }
+
+    nlohmann::json getQueryCacheStats() const
+    {
+        return queryCache.stats();
+    }
+
+    // Parse, expand and validate query, or reuse the result of doing so for
+    // the same text earlier. Failures are reported but not cached.
+    Result<std::shared_ptr<const PreparedOperation>>
+        prepare(const std::string& query)
+    {
+        if (auto prepared = queryCache.find(query))
+        {
+            return prepared;
+        }
+
+        Result<Operation> parseResult = Parser::tryParse(query);
+        if (!parseResult)
+        {
+            return std::unexpected(parseResult.error());
+        }
+
+        auto prepared = std::make_shared<PreparedOperation>();
+        prepared->operation = std::move(*parseResult);
+        try
+        {
+            expandFragments(prepared->operation);
+        }
+        catch (const std::exception& e)
+        {
+            return std::unexpected(std::string(e.what()));
+        }
+
+        if (auto r = schema.validateOperation(prepared->operation); !r)
+        {
+            return std::unexpected(r.error());
+        }
+
+        prepared->canonical = canonicalText(prepared->operation);
+        prepared->defaultVariables = initialVariables(prepared->operation);
+        plan(*prepared);
+        queryCache.insert(query, prepared);
+        return prepared;
+    }
+
     nlohmann::json getSubscriptionStats() const
     {
         size_t activeSharedLoops = activeSubscriptions.size();
@@ -40,6 +104,8 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
             nlohmann::json sessionDetails = {
                 {"key", key},
                 {"subscriber_count", subsCount},
+                {"polls", session->polls},
+                {"changes", session->changes},
                 {"last_result", session->lastResult ? *session->lastResult : nullptr}
             };
             details.push_back(sessionDetails);
@@ -68,32 +134,24 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
     {
         nlohmann::json response;
 
-        Result<Operation> parseResult = Parser::tryParse(query);
-        if (!parseResult)
+        Result<std::shared_ptr<const PreparedOperation>> prepared =
+            prepare(query);
+        if (!prepared)
         {
             response["errors"] = nlohmann::json::array();
-            response["errors"].push_back({{"message", parseResult.error()}});
+            response["errors"].push_back({{"message", prepared.error()}});
             co_return response;
         }
 
-        Operation operation = std::move(*parseResult);
-        expandFragments(operation);
-
-        if (auto r = schema.validateOperation(operation); !r)
-        {
-            response["errors"] = nlohmann::json::array();
-            response["errors"].push_back({{"message", r.error()}});
-            co_return response;
-        }
-
-        nlohmann::json mergedVariables = initialVariables(operation);
+        nlohmann::json mergedVariables = (*prepared)->defaultVariables;
         for (auto it = variables.begin(); it != variables.end(); ++it)
         {
             mergedVariables[it.key()] = it.value();
         }
 
-        Result<nlohmann::json> dataResult =
-            co_await executeSelections(operation.selections, mergedVariables);
+        ExecutionContext context(co_await boost::asio::this_coro::executor,
+                                 *prepared, mergedVariables, maxConcurrency);
+        Result<nlohmann::json> dataResult = co_await executeSelections(context);
         if (!dataResult)
         {
             response["errors"] = nlohmann::json::array();
@@ -107,20 +165,36 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
         co_return response;
     }
 
+    // What a subscriber receives after the first event.
+    enum class SubscriptionMode
+    {
+        Snapshot, // the full result, every interval
+        Delta     // {"patch": [...]}: RFC 6902 ops against the previous event,
+                  // and only when the result changed
+    };
+
     struct Subscriber
     {
         uint64_t id;
-        std::function<boost::asio::awaitable<bool>(nlohmann::json)> callback;
+        std::function<boost::asio::awaitable<bool>(const nlohmann::json&)>
+            callback;
         std::shared_ptr<boost::asio::steady_timer> disconnectTimer;
+        SubscriptionMode mode{SubscriptionMode::Snapshot};
+        // A write to this subscriber is in progress; ticks skip it meanwhile.
+        bool sending{false};
+        // The event this subscriber holds, to which a patch would apply.
+        std::shared_ptr<const nlohmann::json> delivered;
     };
 
     struct SubscriptionSession
     {
         std::string key;
         std::shared_ptr<boost::asio::steady_timer> timer;
-        std::vector<Subscriber> subscribers;
+        std::vector<std::shared_ptr<Subscriber>> subscribers;
         uint64_t nextSubscriberId{1};
-        std::optional<nlohmann::json> lastResult;
+        std::shared_ptr<const nlohmann::json> lastResult;
+        uint64_t polls{0};
+        uint64_t changes{0};
         bool active{true};
     };
 
@@ -146,17 +220,36 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
     void removeSubscriber(std::shared_ptr<SubscriptionSession> session, uint64_t id)
     {
         auto it = std::find_if(session->subscribers.begin(), session->subscribers.end(),
-                               [id](const Subscriber& s) { return s.id == id; });
+                               [id](const auto& s) { return s->id == id; });
         if (it != session->subscribers.end())
         {
-            it->disconnectTimer->cancel();
+            (*it)->disconnectTimer->cancel();
             session->subscribers.erase(it);
         }
     }
 
+    // Write event to one subscriber, who then holds snapshot. Callers set
+    // subscriber->sending before spawning this; the poll loop doesn't wait
+    // for it, so a slow client only delays itself.
+    boost::asio::awaitable<void> deliver(
+        std::shared_ptr<SubscriptionSession> session,
+        std::shared_ptr<Subscriber> subscriber,
+        std::shared_ptr<const nlohmann::json> snapshot,
+        std::shared_ptr<const nlohmann::json> event)
+    {
+        bool ok = co_await subscriber->callback(*event);
+        subscriber->sending = false;
+        if (!ok)
+        {
+            removeSubscriber(session, subscriber->id);
+            co_return;
+        }
+        subscriber->delivered = std::move(snapshot);
+    }
+
     boost::asio::awaitable<void> runSubscriptionLoop(
         std::shared_ptr<SubscriptionSession> session,
-        Operation operation,
+        std::shared_ptr<const PreparedOperation> prepared,
         nlohmann::json mergedVariables,
         std::chrono::steady_clock::duration interval)
     {
@@ -164,9 +257,14 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
 
         while (session->active && !session->subscribers.empty())
         {
-            Result<nlohmann::json> tickResult =
-                co_await executeSubscriptionSelections(operation.selections,
-                                                       mergedVariables);
+            Result<nlohmann::json> tickResult;
+            {
+                // Each tick fetches afresh.
+                ExecutionContext context(
+                    co_await boost::asio::this_coro::executor, prepared,
+                    mergedVariables, maxConcurrency);
+                tickResult = co_await executeSubscriptionSelections(context);
+            }
 
             nlohmann::json event;
             if (!tickResult)
@@ -179,35 +277,55 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
                 event["data"] = std::move(*tickResult);
             }
 
-            session->lastResult = event;
-
-            // Broadcast to all active subscribers
-            std::vector<uint64_t> failedSubIds;
-            for (auto& sub : session->subscribers)
+            auto previous = session->lastResult;
+            bool changed = !previous || *previous != event;
+            auto snapshot =
+                changed ? std::make_shared<const nlohmann::json>(std::move(event))
+                        : previous;
+            session->lastResult = snapshot;
+            session->polls++;
+            session->changes += changed ? 1 : 0;
+
+            // One result, one diff, however many subscribers.
+            std::shared_ptr<const nlohmann::json> patch;
+            auto exec = co_await boost::asio::this_coro::executor;
+            for (const auto& sub : session->subscribers)
             {
-                bool ok = co_await sub.callback(event);
-                if (!ok)
+                if (sub->sending)
                 {
-                    failedSubIds.push_back(sub.id);
+                    continue;
                 }
-            }
-
-            // Clean up disconnected subscribers
-            for (uint64_t id : failedSubIds)
-            {
-                removeSubscriber(session, id);
-            }
-
-            if (session->subscribers.empty())
-            {
-                break;
+                std::shared_ptr<const nlohmann::json> out = snapshot;
+                if (sub->mode == SubscriptionMode::Delta && sub->delivered)
+                {
+                    if (sub->delivered == snapshot)
+                    {
+                        continue;
+                    }
+                    if (sub->delivered == previous)
+                    {
+                        if (!patch)
+                        {
+                            patch = std::make_shared<const nlohmann::json>(
+                                nlohmann::json{
+                                    {"patch",
+                                     nlohmann::json::diff(*previous,
+                                                          *snapshot)}});
+                        }
+                        out = patch;
+                    }
+                }
+                sub->sending = true;
+                boost::asio::co_spawn(exec,
+                                      deliver(session, sub, snapshot, out),
+                                      boost::asio::detached);
             }
 
             session->timer->expires_after(interval);
             boost::system::error_code ec;
             co_await session->timer->async_wait(
                 boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-            if (ec)
+            if (ec && session->subscribers.empty())
             {
                 break;
             }
@@ -216,42 +334,34 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
         activeSubscriptions.erase(session->key);
     }
 
-    // Execute a subscription: identical query/variables/interval requests
-    // are coalesced into a single background polling loop.
+    // Execute a subscription: requests for the same operation (compared in
+    // canonical form), variables and interval are coalesced into a single
+    // background polling loop, whose results are fanned out to all of them.
     template <typename AsyncEventFn>
     boost::asio::awaitable<void> executeSubscription(
         const std::string& query, const nlohmann::json& variables,
-        std::chrono::steady_clock::duration interval, AsyncEventFn onEvent)
+        std::chrono::steady_clock::duration interval, AsyncEventFn onEvent,
+        SubscriptionMode mode = SubscriptionMode::Snapshot)
     {
-        Result<Operation> parseResult = Parser::tryParse(query);
-        if (!parseResult)
+        Result<std::shared_ptr<const PreparedOperation>> prepared =
+            prepare(query);
+        if (!prepared)
         {
             nlohmann::json err;
             err["errors"] = nlohmann::json::array();
-            err["errors"].push_back({{"message", parseResult.error()}});
+            err["errors"].push_back({{"message", prepared.error()}});
             co_await onEvent(std::move(err));
             co_return;
         }
 
-        Operation operation = std::move(*parseResult);
-        expandFragments(operation);
-
-        if (auto r = schema.validateOperation(operation); !r)
-        {
-            nlohmann::json err;
-            err["errors"] = nlohmann::json::array();
-            err["errors"].push_back({{"message", r.error()}});
-            co_await onEvent(std::move(err));
-            co_return;
-        }
-
-        nlohmann::json mergedVariables = initialVariables(operation);
+        nlohmann::json mergedVariables = (*prepared)->defaultVariables;
         for (auto it = variables.begin(); it != variables.end(); ++it)
         {
             mergedVariables[it.key()] = it.value();
         }
 
-        std::string key = query + "|" + mergedVariables.dump() + "|" + std::to_string(interval.count());
+        std::string key = (*prepared)->canonical + "|" + mergedVariables.dump() +
+                          "|" + std::to_string(interval.count());
 
         auto exec = co_await boost::asio::this_coro::executor;
 
@@ -276,15 +386,15 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
         disconnectTimer->expires_at(std::chrono::steady_clock::time_point::max());
 
         uint64_t subId = session->nextSubscriberId++;
-        Subscriber subscriber{
+        auto subscriber = std::make_shared<Subscriber>(Subscriber{
             subId,
-            [onEvent](nlohmann::json event) -> boost::asio::awaitable<bool> {
-                co_return co_await onEvent(std::move(event));
+            [onEvent](const nlohmann::json& event)
+                -> boost::asio::awaitable<bool> {
+                co_return co_await onEvent(event);
             },
-            disconnectTimer
-        };
+            disconnectTimer, mode});
 
-        session->subscribers.push_back(std::move(subscriber));
+        session->subscribers.push_back(subscriber);
 
         SubscriberCleanupGuard guard{*this, session, subId};
 
@@ -292,21 +402,18 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
         {
             boost::asio::co_spawn(
                 exec,
-                runSubscriptionLoop(session, std::move(operation), mergedVariables, interval),
+                runSubscriptionLoop(session, *prepared, mergedVariables, interval),
                 boost::asio::detached);
         }
         else if (session->lastResult)
         {
-            boost::asio::co_spawn(
-                exec,
-                [callback = session->subscribers.back().callback, lastResult = *session->lastResult, disconnectTimer]() -> boost::asio::awaitable<void> {
-                    bool ok = co_await callback(lastResult);
-                    if (!ok)
-                    {
-                        disconnectTimer->cancel();
-                    }
-                },
-                boost::asio::detached);
+            // Late joiners start from the latest result.
+            subscriber->sending = true;
+            boost::asio::co_spawn(exec,
+                                  deliver(session, subscriber,
+                                          session->lastResult,
+                                          session->lastResult),
+                                  boost::asio::detached);
         }
 
         boost::system::error_code ec;
@@ -317,72 +424,235 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
     }
 
   protected:
+    // DataLoader-style memo of the targets fetched by one execution. Fields
+    // that ask for the same target, at the same time or later, share the
+    // result of the first fetch.
+    class TargetLoader
+    {
+      public:
+        explicit TargetLoader(boost::asio::any_io_executor exec) : exec(exec)
+        {}
+
+        template <typename Fetch>
+        boost::asio::awaitable<Result<nlohmann::json>>
+            load(const std::string& target, Fetch fetch)
+        {
+            if (auto it = entries.find(target); it != entries.end())
+            {
+                auto entry = it->second;
+                if (!entry->result)
+                {
+                    boost::system::error_code ec;
+                    co_await entry->ready.async_wait(boost::asio::redirect_error(
+                        boost::asio::use_awaitable, ec));
+                }
+                co_return *entry->result;
+            }
+            auto entry = std::make_shared<Entry>(exec);
+            entries.emplace(target, entry);
+            try
+            {
+                entry->result = co_await fetch();
+            }
+            catch (const std::exception& e)
+            {
+                entry->result = std::unexpected(std::string(e.what()));
+            }
+            entry->ready.cancel();
+            co_return *entry->result;
+        }
+
+      private:
+        struct Entry
+        {
+            explicit Entry(boost::asio::any_io_executor exec) : ready(exec)
+            {
+                ready.expires_at(std::chrono::steady_clock::time_point::max());
+            }
+            boost::asio::steady_timer ready;
+            std::optional<Result<nlohmann::json>> result;
+        };
+        boost::asio::any_io_executor exec;
+        std::unordered_map<std::string, std::shared_ptr<Entry>> entries;
+    };
+
+    // Admits at most limit fetches of one execution at a time, first come
+    // first served; 0 admits all. Limiting the fetches rather than the
+    // fan-out of each selection bounds the whole execution, however deeply
+    // its fields nest, and a field waiting for its members never holds a
+    // slot they need.
+    class FetchLimiter
+    {
+      public:
+        FetchLimiter(boost::asio::any_io_executor exec, std::size_t limit) :
+            exec(exec), limit(limit)
+        {}
+
+        // Releases its slot, if it holds one, when destroyed.
+        class Slot
+        {
+          public:
+            explicit Slot(FetchLimiter* limiter) : limiter(limiter) {}
+            Slot(Slot&& other) noexcept :
+                limiter(std::exchange(other.limiter, nullptr))
+            {}
+            Slot& operator=(Slot&&) = delete;
+            ~Slot()
+            {
+                if (limiter != nullptr)
+                {
+                    limiter->release();
+                }
+            }
+
+          private:
+            FetchLimiter* limiter;
+        };
+
+        boost::asio::awaitable<Slot> acquire()
+        {
+            if (limit == 0)
+            {
+                co_return Slot(nullptr);
+            }
+            if (active < limit && waiters.empty())
+            {
+                ++active;
+                co_return Slot(this);
+            }
+            auto waiter = std::make_shared<boost::asio::steady_timer>(exec);
+            waiter->expires_at(std::chrono::steady_clock::time_point::max());
+            waiters.push_back(waiter);
+            boost::system::error_code ec;
+            co_await waiter->async_wait(
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            co_return Slot(this); // handed over by release()
+        }
+
+      private:
+        void release()
+        {
+            if (waiters.empty())
+            {
+                --active;
+                return;
+            }
+            waiters.front()->cancel();
+            waiters.pop_front();
+        }
+
+        boost::asio::any_io_executor exec;
+        std::size_t limit;
+        std::size_t active{0};
+        std::deque<std::shared_ptr<boost::asio::steady_timer>> waiters;
+    };
+
+    // What the resolvers of one execution share: its variables, its
+    // prepared operation and the fetches made under it. Lives for the
+    // duration of the execution, and every resolver gets it passed in.
+    struct ExecutionContext
+    {
+        ExecutionContext(boost::asio::any_io_executor exec,
+                         std::shared_ptr<const PreparedOperation> prepared,
+                         const nlohmann::json& variables,
+                         std::size_t maxConcurrency) :
+            variables(variables), prepared(std::move(prepared)), loader(exec),
+            limiter(exec, maxConcurrency)
+        {}
+        ExecutionContext(const ExecutionContext&) = delete;
+        ExecutionContext& operator=(const ExecutionContext&) = delete;
+
+        const nlohmann::json& variables;
+        std::shared_ptr<const PreparedOperation> prepared;
+        TargetLoader loader;
+        FetchLimiter limiter;
+    };
+
     virtual boost::asio::awaitable<Result<nlohmann::json>> resolveRootField(
         const FieldSelection& selection, const FieldSpec& fieldSpec,
-        const nlohmann::json& variables) = 0;
+        ExecutionContext& context) = 0;
 
     virtual boost::asio::awaitable<Result<nlohmann::json>>
         resolveSubscriptionField(const FieldSelection& selection,
                                  const FieldSpec& fieldSpec,
-                                 const nlohmann::json& variables)
+                                 ExecutionContext& context)
     {
         // Default: delegate to the same resolution as queries
-        co_return co_await resolveRootField(selection, fieldSpec, variables);
+        co_return co_await resolveRootField(selection, fieldSpec, context);
     }
 
     boost::asio::awaitable<Result<nlohmann::json>> executeSubscriptionSelections(
-        const std::vector<FieldSelection>& selections,
-        const nlohmann::json& variables)
+        ExecutionContext& context)
     {
-        nlohmann::json result = nlohmann::json::object();
-        for (const FieldSelection& selection : selections)
+        const PreparedOperation& prepared = *context.prepared;
+        const bool planned =
+            prepared.operation.type == Operation::Type::Subscription;
+        co_return co_await resolveSelections(
+            prepared.operation.selections, "subscription",
+            [this, &prepared, planned](std::size_t index,
+                                       const std::string& name) {
+                return planned ? prepared.rootFields[index]
+                               : schema.getRootSubscriptionField(name);
+            },
+            [this, &context](const FieldSelection& selection,
+                             const FieldSpec& fieldSpec) {
+                return resolveSubscriptionField(selection, fieldSpec, context);
+            });
+    }
+
+    boost::asio::awaitable<Result<nlohmann::json>> executeSelections(
+        ExecutionContext& context)
+    {
+        const PreparedOperation& prepared = *context.prepared;
+        const bool planned = prepared.operation.type == Operation::Type::Query;
+        co_return co_await resolveSelections(
+            prepared.operation.selections, "query",
+            [this, &prepared, planned](std::size_t index,
+                                       const std::string& name) {
+                return planned ? prepared.rootFields[index]
+                               : schema.getRootQueryField(name);
+            },
+            [this, &context](const FieldSelection& selection,
+                             const FieldSpec& fieldSpec) {
+                return resolveRootField(selection, fieldSpec, context);
+            });
+    }
+
+    // Resolve the root fields of selections concurrently and collect them in
+    // selection order; the first failing field fails the whole result. The
+    // execution's FetchLimiter bounds how many of them fetch at a time.
+    template <typename FindField, typename ResolveField>
+    boost::asio::awaitable<Result<nlohmann::json>> resolveSelections(
+        const std::vector<FieldSelection>& selections, const std::string& kind,
+        FindField findField, ResolveField resolveField)
+    {
+        std::vector<boost::asio::awaitable<Result<nlohmann::json>>> fields;
+        fields.reserve(selections.size());
+        for (std::size_t i = 0; i < selections.size(); ++i)
         {
-            const FieldSpec* fieldSpec =
-                schema.getRootSubscriptionField(selection.name);
+            const FieldSelection& selection = selections[i];
+            const FieldSpec* fieldSpec = findField(i, selection.name);
             if (fieldSpec == nullptr)
             {
-                co_return std::unexpected("Unknown subscription field: " +
+                co_return std::unexpected("Unknown " + kind + " field: " +
                                           selection.name);
             }
-
-            std::string outputName =
-                selection.alias.empty() ? selection.name : selection.alias;
-            Result<nlohmann::json> fieldResult =
-                co_await resolveSubscriptionField(selection, *fieldSpec,
-                                                  variables);
-            if (!fieldResult)
-            {
-                co_return std::unexpected(fieldResult.error());
-            }
-            result[outputName] = std::move(*fieldResult);
+            fields.push_back(resolveField(selection, *fieldSpec));
         }
-        co_return result;
-    }
+        std::vector<Result<nlohmann::json>> fieldResults =
+            co_await when_all(std::move(fields));
 
-    boost::asio::awaitable<Result<nlohmann::json>> executeSelections(
-        const std::vector<FieldSelection>& selections,
-        const nlohmann::json& variables)
-    {
         nlohmann::json result = nlohmann::json::object();
-        for (const FieldSelection& selection : selections)
+        for (std::size_t i = 0; i < selections.size(); ++i)
         {
-            const FieldSpec* fieldSpec =
-                schema.getRootQueryField(selection.name);
-            if (fieldSpec == nullptr)
+            if (!fieldResults[i])
             {
-                co_return std::unexpected("Unknown query field: " +
-                                          selection.name);
+                co_return std::unexpected(fieldResults[i].error());
             }
-
+            const FieldSelection& selection = selections[i];
             std::string outputName =
                 selection.alias.empty() ? selection.name : selection.alias;
-            Result<nlohmann::json> fieldResult =
-                co_await resolveRootField(selection, *fieldSpec, variables);
-            if (!fieldResult)
-            {
-                co_return std::unexpected(fieldResult.error());
-            }
-            result[outputName] = std::move(*fieldResult);
+            result[outputName] = std::move(*fieldResults[i]);
         }
         co_return result;
     }
@@ -520,7 +790,7 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
     // override resolveRootField entirely and handle only their custom cases.
     boost::asio::awaitable<Result<nlohmann::json>> resolveByPath(
         const FieldSelection& selection, const FieldSpec& fieldSpec,
-        const nlohmann::json& variables, bool fresh = false)
+        ExecutionContext& context, bool fresh = false)
     {
         if (fieldSpec.redfishPath.empty())
         {
@@ -528,13 +798,20 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
                                       fieldSpec.name);
         }
 
-        nlohmann::json args = resolveArguments(selection, variables);
-        const std::string target = expandPath(fieldSpec.redfishPath, args,
-                                              fieldSpec);
+        std::string target;
+        if (const std::string* planned = plannedTarget(selection, context))
+        {
+            target = *planned;
+        }
+        else
+        {
+            nlohmann::json args =
+                resolveArguments(selection, context.variables);
+            target = expandPath(fieldSpec.redfishPath, args, fieldSpec);
+        }
 
         Result<nlohmann::json> payloadResult =
-            fresh ? co_await provider->getFresh(target)
-                  : co_await provider->get(target);
+            co_await load(target, fresh, context);
         if (!payloadResult)
         {
             co_return std::unexpected(payloadResult.error());
@@ -550,29 +827,30 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
                     "'");
             }
 
-            nlohmann::json result = nlohmann::json::array();
+            // Members are fetched concurrently, as many at a time as the
+            // execution's FetchLimiter admits.
+            std::vector<boost::asio::awaitable<Result<nlohmann::json>>> items;
             for (const auto& member : payload["Members"])
             {
                 if (!member.contains("@odata.id"))
                 {
                     continue;
                 }
-                Result<nlohmann::json> itemResult =
-                    fresh ? co_await provider->getFresh(
-                                member["@odata.id"].get<std::string>())
-                          : co_await provider->get(
-                                member["@odata.id"].get<std::string>());
+                items.push_back(resolveMember(
+                    member["@odata.id"].get<std::string>(), selection,
+                    fieldSpec, context, fresh));
+            }
+            std::vector<Result<nlohmann::json>> itemResults =
+                co_await when_all(std::move(items));
+
+            nlohmann::json result = nlohmann::json::array();
+            for (Result<nlohmann::json>& itemResult : itemResults)
+            {
                 if (!itemResult)
                 {
                     co_return std::unexpected(itemResult.error());
                 }
-                Result<nlohmann::json> projResult = co_await projectObject(
-                    *itemResult, fieldSpec.returnType, selection.selections);
-                if (!projResult)
-                {
-                    co_return std::unexpected(projResult.error());
-                }
-                result.push_back(std::move(*projResult));
+                result.push_back(std::move(*itemResult));
             }
             co_return result;
         }
@@ -586,8 +864,98 @@ class TypedExecutor : public std::enable_shared_from_this<TypedExecutor<Provider
                                          selection.selections);
     }
 
+    // Fetch and project one member of a collection.
+    boost::asio::awaitable<Result<nlohmann::json>> resolveMember(
+        std::string target, const FieldSelection& selection,
+        const FieldSpec& fieldSpec, ExecutionContext& context, bool fresh)
+    {
+        Result<nlohmann::json> itemResult =
+            co_await load(target, fresh, context);
+        if (!itemResult)
+        {
+            co_return std::unexpected(itemResult.error());
+        }
+        co_return co_await projectObject(*itemResult, fieldSpec.returnType,
+                                         selection.selections);
+    }
+
+    // Look up the root fields of prepared and expand the redfishPath of
+    // those whose arguments don't depend on variables.
+    void plan(PreparedOperation& prepared) const
+    {
+        const Operation& operation = prepared.operation;
+        for (const FieldSelection& selection : operation.selections)
+        {
+            const FieldSpec* fieldSpec =
+                (operation.type == Operation::Type::Subscription)
+                    ? schema.getRootSubscriptionField(selection.name)
+                    : schema.getRootQueryField(selection.name);
+            prepared.rootFields.push_back(fieldSpec);
+            if (fieldSpec == nullptr || fieldSpec->redfishPath.empty() ||
+                std::ranges::any_of(selection.arguments,
+                                    [](const Argument& argument) {
+                                        return referencesVariables(
+                                            argument.value.value);
+                                    }))
+            {
+                continue;
+            }
+            try
+            {
+                prepared.targets.emplace(
+                    &selection,
+                    expandPath(fieldSpec->redfishPath,
+                               argumentsToJson(selection.arguments,
+                                               nlohmann::json::object()),
+                               *fieldSpec));
+            }
+            catch (const std::exception&)
+            {
+                // Left for resolveByPath to report when it runs.
+            }
+        }
+    }
+
+    // The target plan() expanded for selection, if the operation being
+    // executed has one.
+    static const std::string* plannedTarget(const FieldSelection& selection,
+                                            const ExecutionContext& context)
+    {
+        if (!context.prepared)
+        {
+            return nullptr;
+        }
+        const auto& targets = context.prepared->targets;
+        auto targetIt = targets.find(&selection);
+        return targetIt == targets.end() ? nullptr : &targetIt->second;
+    }
+
+    // Fetch target from the provider, at most once per execution and with
+    // no more than maxConcurrency fetches of the execution in flight.
+    boost::asio::awaitable<Result<nlohmann::json>> load(
+        const std::string& target, bool fresh, ExecutionContext& context)
+    {
+        auto fetchTarget = [this, &context, target, fresh]() {
+            return fetch(context.limiter, target, fresh);
+        };
+        co_return co_await context.loader.load(target, fetchTarget);
+    }
+
+    boost::asio::awaitable<Result<nlohmann::json>>
+        fetch(FetchLimiter& limiter, std::string target, bool fresh)
+    {
+        auto slot = co_await limiter.acquire();
+        if (fresh)
+        {
+            co_return co_await provider->getFresh(target);
+        }
+        co_return co_await provider->get(target);
+    }
+
     TypedSchema schema;
     std::shared_ptr<Provider> provider;
+    std::size_t maxConcurrency{8};
+    QueryCache queryCache;
 
     std::unordered_map<std::string, std::shared_ptr<SubscriptionSession>> activeSubscriptions;
 };
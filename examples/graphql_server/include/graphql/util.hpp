@@ -4,7 +4,9 @@
 
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -49,6 +51,36 @@ inline nlohmann::json resolveVariables(const nlohmann::json& value,
     return value;
 }
 
+// True if value, at any depth, is a $variable reference.
+inline bool referencesVariables(const nlohmann::json& value)
+{
+    if (value.is_object())
+    {
+        if (value.contains("$variable") && value.size() == 1)
+        {
+            return true;
+        }
+        for (const auto& item : value)
+        {
+            if (referencesVariables(item))
+            {
+                return true;
+            }
+        }
+    }
+    else if (value.is_array())
+    {
+        for (const auto& item : value)
+        {
+            if (referencesVariables(item))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 inline nlohmann::json argumentsToJson(const std::vector<Argument>& arguments,
                                       const nlohmann::json& variables)
 {
@@ -130,6 +162,76 @@ inline void expandFragments(
     expandFragments(operation.selections, operation.fragments, visited);
 }
 
+// Append a canonical rendering of selections to out: no whitespace or
+// comments, arguments in name order. Fragments must already be expanded.
+inline void canonicalSelections(const std::vector<FieldSelection>& selections,
+                                std::string& out)
+{
+    out += '{';
+    for (const FieldSelection& selection : selections)
+    {
+        if (!selection.alias.empty())
+        {
+            out += selection.alias;
+            out += ':';
+        }
+        out += selection.name;
+        if (!selection.arguments.empty())
+        {
+            std::vector<const Argument*> arguments;
+            for (const Argument& argument : selection.arguments)
+            {
+                arguments.push_back(&argument);
+            }
+            std::ranges::sort(arguments, {}, &Argument::name);
+            out += '(';
+            for (const Argument* argument : arguments)
+            {
+                out += argument->name;
+                out += ':';
+                out += argument->value.value.dump();
+                out += ',';
+            }
+            out.back() = ')';
+        }
+        for (const Directive& directive : selection.directives)
+        {
+            out += '@';
+            out += directive.name;
+            out += argumentsToJson(directive.arguments,
+                                   nlohmann::json::object())
+                       .dump();
+        }
+        if (!selection.selections.empty())
+        {
+            canonicalSelections(selection.selections, out);
+        }
+        out += ' ';
+    }
+    out += '}';
+}
+
+// Operations that differ only in layout, operation name or fragment use
+// render to the same text.
+inline std::string canonicalText(const Operation& operation)
+{
+    std::string out;
+    switch (operation.type)
+    {
+        case Operation::Type::Query:
+            out = "query";
+            break;
+        case Operation::Type::Mutation:
+            out = "mutation";
+            break;
+        case Operation::Type::Subscription:
+            out = "subscription";
+            break;
+    }
+    canonicalSelections(operation.selections, out);
+    return out;
+}
+
 inline nlohmann::json filterFields(
     const nlohmann::json& data, const std::vector<FieldSelection>& selections)
 {
@@ -136,6 +136,47 @@ net::awaitable<void> monitorJournal(boost::asio::io_context& io_context)
         }
     }
 }
+// Runs one journalctl export for a single HTTP client. Output is read only
+// when the response writer asks for the next piece, so a slow client leaves
+// journalctl blocked on a full pipe instead of growing a buffer here.
+class JournalExport
+{
+  public:
+    JournalExport(net::io_context& ioc, const std::vector<std::string>& args) :
+        pipe(ioc),
+        child("/usr/bin/journalctl", boost::process::args(args),
+              boost::process::std_out > pipe)
+    {}
+    ~JournalExport()
+    {
+        if (child.running())
+        {
+            child.terminate();
+        }
+    }
+    net::awaitable<std::optional<std::string>> next()
+    {
+        std::string piece(16 * 1024, '\0');
+        boost::system::error_code ec;
+        auto size = co_await pipe.async_read_some(
+            net::buffer(piece), net::redirect_error(net::use_awaitable, ec));
+        if (ec)
+        {
+            if (ec != net::error::eof)
+            {
+                LOG_ERROR("Error reading journal: {}", ec.message());
+            }
+            co_return std::nullopt;
+        }
+        piece.resize(size);
+        co_return piece;
+    }
+
+  private:
+    boost::process::async_pipe pipe;
+    boost::process::child child;
+};
+
 // Coroutine to spawn journalctl and capture output asynchronously
 void startJournalMonitor(boost::asio::io_context& io_context)
 {
@@ -202,6 +243,43 @@ int main(int argc, const char* argv[])
                 co_return make_success_response(jsonResponse, http::status::ok,
                                                 req.version());
             });
+        // Stream the journal, optionally filtered by ?unit=, as a chunked
+        // body without collecting it first.
+        router.add_streaming_get_handler(
+            "/journal/export",
+            [&](auto& req, auto& params) -> net::awaitable<StreamResponse> {
+                std::vector<std::string> args{"--no-pager", "-o",
+                                              "short-iso"};
+                if (auto unit = params["unit"]; !unit.empty())
+                {
+                    args.push_back("-u");
+                    args.push_back(unit);
+                }
+                auto journal = std::make_shared<JournalExport>(io_context, args);
+                StreamedResponse res{{http::status::ok, req.version()}};
+                res.header.set(http::field::content_type, "text/plain");
+                res.next = [journal]() { return journal->next(); };
+                co_return res;
+            });
+        // Serve rotated logs and exported archives straight from disk.
+        router.add_streaming_get_handler(
+            "/journal/files/{name}",
+            [](auto& req, auto& params) -> net::awaitable<StreamResponse> {
+                auto name = params["name"];
+                if (name.empty() || name.front() == '.')
+                {
+                    co_return make_bad_request_error("Invalid file name",
+                                                     req.version());
+                }
+                auto res = make_file_response("/var/log/" + name,
+                                              "application/octet-stream",
+                                              req.version());
+                if (!res)
+                {
+                    co_return make_file_not_found_error(name, req.version());
+                }
+                co_return std::move(*res);
+            });
         io_context.run();
     }
     catch (std::exception& e)
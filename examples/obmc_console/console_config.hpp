@@ -2,6 +2,7 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <fstream>
 #include <optional>
 #include <sstream>
@@ -21,6 +22,16 @@ class SshPtyDevice;
 namespace NSNAME
 {
 
+/**
+ * @brief What to do with a client whose output queue is full
+ */
+enum class SlowClientPolicy
+{
+    DropOldest, // Discard the oldest queued chunk to make room
+    Disconnect, // Close the client
+    SkipToLive  // Discard the whole backlog and continue with new output
+};
+
 /**
  * @brief Base configuration common to all device types
  */
@@ -32,6 +43,12 @@ struct BaseDeviceConfig
     int baudRate = 115200;    // Baud rate (for UART/VUART)
     mode_t socketMode = 0666; // Socket file permissions (default: rw-rw-rw-)
     std::string socketGroup;  // Socket group ownership (optional)
+    // Console history kept for new clients, optionally in a mapped file
+    size_t historySize = 128 * 1024;
+    std::string historyFile;
+    // Output chunks queued per client before slowClientPolicy applies
+    size_t clientQueueDepth = 256;
+    SlowClientPolicy slowClientPolicy = SlowClientPolicy::DropOldest;
 };
 
 /**
@@ -219,10 +236,18 @@ struct ConsoleConfig
      * @brief Parse logsize string to bytes
      */
     size_t getLogsizeBytes() const
+    {
+        return parseSize(logsize);
+    }
+
+    /**
+     * @brief Parse a size with an optional k/m/g suffix to bytes
+     */
+    static size_t parseSize(const std::string& size)
     {
         size_t value = 0;
         char unit = 0;
-        std::istringstream iss(logsize);
+        std::istringstream iss(size);
         iss >> value >> unit;
 
         switch (unit)
@@ -366,6 +391,44 @@ struct ConsoleConfig
         return mux;
     }
 
+    /**
+     * @brief Apply the history and client queue settings from values
+     */
+    static void parseOutputConfig(
+        BaseDeviceConfig& base,
+        const std::unordered_map<std::string, std::string>& values)
+    {
+        if (values.count("history-size"))
+        {
+            base.historySize = parseSize(values.at("history-size"));
+        }
+        if (values.count("history-file"))
+        {
+            base.historyFile = values.at("history-file");
+        }
+        if (values.count("client-queue-depth"))
+        {
+            base.clientQueueDepth = std::max(
+                1, std::stoi(values.at("client-queue-depth")));
+        }
+        if (values.count("slow-client-policy"))
+        {
+            const std::string& policy = values.at("slow-client-policy");
+            if (policy == "disconnect")
+            {
+                base.slowClientPolicy = SlowClientPolicy::Disconnect;
+            }
+            else if (policy == "skip-to-live")
+            {
+                base.slowClientPolicy = SlowClientPolicy::SkipToLive;
+            }
+            else
+            {
+                base.slowClientPolicy = SlowClientPolicy::DropOldest;
+            }
+        }
+    }
+
     /**
      * @brief Load configuration from file
      *
@@ -375,6 +438,10 @@ struct ConsoleConfig
      *   device = /dev/ttyS0
      *   socket-path = /tmp/obmc-console.sock
      *   local-tty-baud = 115200
+     *   history-size = 128k
+     *   history-file = /var/lib/obmc-console/host.history   (optional)
+     *   client-queue-depth = 256
+     *   slow-client-policy = drop-oldest   (or disconnect, skip-to-live)
      *
      * Multi-device format:
      *   [console.host]
@@ -494,6 +561,8 @@ struct ConsoleConfig
                 device.base.socketGroup = globalValues["socket-group"];
             }
 
+            parseOutputConfig(device.base, globalValues);
+
             device.specific = createSpecificConfig(typeStr, globalValues);
             device.mux = createMuxConfig(globalValues);
 
@@ -553,6 +622,8 @@ struct ConsoleConfig
                     device.base.socketGroup = values.at("socket-group");
                 }
 
+                parseOutputConfig(device.base, values);
+
                 device.specific = createSpecificConfig(typeStr, values);
                 device.mux = createMuxConfig(values);
 
@@ -0,0 +1,345 @@
+#pragma once
+#include "beastdefs.hpp"
+#include "logger.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace NSNAME
+{
+
+/**
+ * @brief Console output shared read-only by the history and client queues
+ *
+ * Holding a chunk keeps the memory it points into alive.
+ */
+struct ConsoleChunk
+{
+    std::shared_ptr<const char> data;
+    size_t size = 0;
+
+    net::const_buffer buffer() const
+    {
+        return {data.get(), size};
+    }
+};
+
+/**
+ * @brief Console history kept as a ring of fixed-size, page-aligned segments
+ *
+ * Device reads land directly in the newest segment (writable(), then
+ * commit()), and commit() hands the new bytes out as a chunk referencing the
+ * segment, so output is never copied on its way to the clients. replay()
+ * returns the whole history as one chunk per segment, oldest first, ready
+ * for a gather write.
+ *
+ * Chunks keep their segment alive. When the ring wraps onto a segment that
+ * a client is still writing from, it takes a fresh segment rather than
+ * overwrite it; the old one is released with its last chunk.
+ *
+ * With a backing file the segments are slots of a shared mapping of that
+ * file, so the history survives a restart and lives in the page cache
+ * instead of anonymous memory. The file has spare slots for segments that
+ * clients still hold; should those run out, the ring falls back to a heap
+ * segment, which is not persisted.
+ */
+class ConsoleHistory
+{
+  public:
+    static constexpr size_t segmentSize = 16 * 1024;
+
+    explicit ConsoleHistory(size_t capacity,
+                            const std::string& backingFile = {}) :
+        segments_(std::max<size_t>(2, (capacity + segmentSize - 1) /
+                                          segmentSize))
+    {
+        if (!backingFile.empty())
+        {
+            mapFile(backingFile);
+        }
+        if (!segments_[head_])
+        {
+            segments_[head_] = acquire(head_);
+        }
+    }
+
+    /**
+     * @brief Space to read new output into, at the end of the newest segment
+     */
+    net::mutable_buffer writable()
+    {
+        if (headSize_ == segmentSize)
+        {
+            advance();
+        }
+        return {segments_[head_].get() + headSize_, segmentSize - headSize_};
+    }
+
+    /**
+     * @brief Add the first bytes of writable() to the history
+     * @return The added bytes, for broadcasting
+     */
+    ConsoleChunk commit(size_t bytes)
+    {
+        const auto& segment = segments_[head_];
+        ConsoleChunk chunk{
+            std::shared_ptr<const char>(segment, segment.get() + headSize_),
+            bytes};
+        headSize_ += bytes;
+        if (header_ != nullptr)
+        {
+            header_->headSize = static_cast<uint32_t>(headSize_);
+        }
+        return chunk;
+    }
+
+    /**
+     * @brief The history as a scatter-gather list, oldest first
+     */
+    std::vector<ConsoleChunk> replay() const
+    {
+        std::vector<ConsoleChunk> chunks;
+        for (size_t i = 1; i <= segments_.size(); i++)
+        {
+            size_t pos = (head_ + i) % segments_.size();
+            size_t bytes = pos == head_ ? headSize_ : segmentSize;
+            if (segments_[pos] && bytes > 0)
+            {
+                chunks.push_back({segments_[pos], bytes});
+            }
+        }
+        return chunks;
+    }
+
+    /**
+     * @brief Bytes of history held
+     */
+    size_t size() const
+    {
+        size_t bytes = headSize_;
+        for (size_t pos = 0; pos < segments_.size(); pos++)
+        {
+            if (pos != head_ && segments_[pos])
+            {
+                bytes += segmentSize;
+            }
+        }
+        return bytes;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+  private:
+    static constexpr std::array<char, 8> fileMagic{'C', 'O', 'N', 'H',
+                                                   'I', 'S', 'T', '1'};
+
+    // Start of the backing file, followed by the slot of each ring position
+    // (-1 for none) and, from dataOffset on, the slots themselves.
+    struct FileHeader
+    {
+        std::array<char, 8> magic;
+        uint32_t segmentSize;
+        uint32_t segmentCount;
+        uint32_t slotCount;
+        uint32_t head;
+        uint32_t headSize;
+        uint32_t reserved;
+    };
+
+    struct Mapping
+    {
+        char* base = nullptr;
+        size_t length = 0;
+        size_t dataOffset = 0;
+        std::vector<uint32_t> freeSlots;
+
+        ~Mapping()
+        {
+            if (base != nullptr)
+            {
+                ::munmap(base, length);
+            }
+        }
+        char* slot(uint32_t index) const
+        {
+            return base + dataOffset + index * segmentSize;
+        }
+    };
+
+    int32_t* slotTable() const
+    {
+        return reinterpret_cast<int32_t*>(header_ + 1);
+    }
+
+    void mapFile(const std::string& path)
+    {
+        auto count = static_cast<uint32_t>(segments_.size());
+        auto slotCount = count + std::max<uint32_t>(2, count / 4);
+        auto pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t tableEnd = sizeof(FileHeader) + count * sizeof(int32_t);
+        auto mapping = std::make_shared<Mapping>();
+        mapping->dataOffset = (tableEnd + pageSize - 1) / pageSize * pageSize;
+        mapping->length = mapping->dataOffset + slotCount * segmentSize;
+
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0)
+        {
+            LOG_ERROR("Cannot open console history file {}: {}", path,
+                      strerror(errno));
+            return;
+        }
+        struct stat st{};
+        bool sameSize = ::fstat(fd, &st) == 0 &&
+                        static_cast<size_t>(st.st_size) == mapping->length;
+        void* mem = MAP_FAILED;
+        if (sameSize ||
+            ::ftruncate(fd, static_cast<off_t>(mapping->length)) == 0)
+        {
+            mem = ::mmap(nullptr, mapping->length, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (mem == MAP_FAILED)
+        {
+            LOG_ERROR("Cannot map console history file {}: {}", path,
+                      strerror(errno));
+            return;
+        }
+        mapping->base = static_cast<char*>(mem);
+        mapping_ = std::move(mapping);
+        header_ = reinterpret_cast<FileHeader*>(mapping_->base);
+
+        bool valid = sameSize && header_->magic == fileMagic &&
+                     header_->segmentSize == segmentSize &&
+                     header_->segmentCount == count &&
+                     header_->slotCount == slotCount &&
+                     header_->head < count &&
+                     header_->headSize <= segmentSize;
+        if (!valid)
+        {
+            header_->magic = fileMagic;
+            header_->segmentSize = segmentSize;
+            header_->segmentCount = count;
+            header_->slotCount = slotCount;
+            header_->head = 0;
+            header_->headSize = 0;
+            std::fill_n(slotTable(), count, -1);
+        }
+        restore();
+        LOG_INFO("Console history file {}: {} bytes restored", path, size());
+    }
+
+    // Rebuild the ring from the file, newest segment first, up to the first
+    // position without a valid slot.
+    void restore()
+    {
+        head_ = header_->head;
+        headSize_ = header_->headSize;
+        std::vector<bool> used(header_->slotCount, false);
+        int32_t* table = slotTable();
+        bool intact = true;
+        for (size_t i = 0; i < segments_.size(); i++)
+        {
+            size_t pos = (head_ + segments_.size() - i) % segments_.size();
+            int32_t slot = table[pos];
+            intact = intact && slot >= 0 &&
+                     static_cast<uint32_t>(slot) < header_->slotCount &&
+                     !used[static_cast<uint32_t>(slot)];
+            if (!intact)
+            {
+                table[pos] = -1;
+                continue;
+            }
+            used[static_cast<uint32_t>(slot)] = true;
+            segments_[pos] = slotSegment(static_cast<uint32_t>(slot));
+        }
+        if (!segments_[head_])
+        {
+            headSize_ = header_->headSize = 0;
+        }
+        for (uint32_t slot = header_->slotCount; slot-- > 0;)
+        {
+            if (!used[slot])
+            {
+                mapping_->freeSlots.push_back(slot);
+            }
+        }
+    }
+
+    std::shared_ptr<char> slotSegment(uint32_t slot)
+    {
+        return std::shared_ptr<char>(
+            mapping_->slot(slot),
+            [mapping = mapping_, slot](char*) {
+                mapping->freeSlots.push_back(slot);
+            });
+    }
+
+    // A segment for ring position pos, recorded in the file if there is one.
+    std::shared_ptr<char> acquire(size_t pos)
+    {
+        if (mapping_)
+        {
+            if (!mapping_->freeSlots.empty())
+            {
+                uint32_t slot = mapping_->freeSlots.back();
+                mapping_->freeSlots.pop_back();
+                slotTable()[pos] = static_cast<int32_t>(slot);
+                slotsExhausted_ = false;
+                return slotSegment(slot);
+            }
+            if (!slotsExhausted_)
+            {
+                LOG_WARNING("Console history slots all held by clients, "
+                            "newest output is not saved to the file");
+                slotsExhausted_ = true;
+            }
+            slotTable()[pos] = -1;
+        }
+        auto pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        return std::shared_ptr<char>(
+            static_cast<char*>(std::aligned_alloc(pageSize, segmentSize)),
+            [](char* memory) { std::free(memory); });
+    }
+
+    void advance()
+    {
+        head_ = (head_ + 1) % segments_.size();
+        headSize_ = 0;
+        auto& segment = segments_[head_];
+        if (!segment || segment.use_count() > 1)
+        {
+            // Clients still writing from it keep the old one alive
+            segment.reset();
+            segment = acquire(head_);
+        }
+        if (header_ != nullptr)
+        {
+            header_->head = static_cast<uint32_t>(head_);
+            header_->headSize = 0;
+        }
+    }
+
+    std::vector<std::shared_ptr<char>> segments_; // by ring position
+    size_t head_ = 0;     // position being appended to
+    size_t headSize_ = 0; // bytes in the head segment
+    std::shared_ptr<Mapping> mapping_;
+    FileHeader* header_ = nullptr;
+    bool slotsExhausted_ = false;
+};
+
+} // namespace NSNAME
@@ -5,7 +5,7 @@
  * This server extends the basic console server to support multiple devices:
  * - Multiple UART/VUART/PTY devices simultaneously
  * - Each device has its own Unix socket
- * - Independent ringbuffers for each console
+ * - Independent history rings for each console
  * - D-Bus interface for each console instance
  * - GPIO-based multiplexing support
  *
@@ -18,6 +18,7 @@
 #include "completion_handler.hpp"
 #include "console_config.hpp"
 #include "console_dbus.hpp"
+#include "console_history.hpp"
 #include "logger.hpp"
 #include "pty_device.hpp"
 #include "ssh_pty_device_libssh2.hpp"
@@ -30,10 +31,10 @@
 
 #include <boost/asio/local/stream_protocol.hpp>
 #include <boost/asio/ssl.hpp>
-#include <boost/circular_buffer.hpp>
 #include <sdbusplus/asio/connection.hpp>
 
 #include <csignal>
+#include <deque>
 #include <memory>
 #include <set>
 #include <stop_token>
@@ -49,14 +50,6 @@ MultiConsoleServer* g_serverInstance = nullptr;
 
 void signalHandler(int signal);
 
-/**
- * @brief Type alias for console history buffer
- */
-using RingBuffer = boost::circular_buffer<char>;
-
-/**
- * @brief Console router that handles client connections for a specific device
- */
 /**
  * @brief Type-erased client wrapper for broadcasting
  */
@@ -64,36 +57,134 @@ class ClientWriter
 {
   public:
     virtual ~ClientWriter() = default;
-    virtual net::awaitable<void> write(const std::vector<char>& data) = 0;
+    /**
+     * @brief Queue a chunk for the client's writer coroutine
+     * @return false if the client is closed or was disconnected for falling
+     * behind
+     */
+    virtual bool enqueue(ConsoleChunk chunk) = 0;
+    /**
+     * @brief Send the console history ahead of anything enqueued
+     */
+    virtual void replay(std::vector<ConsoleChunk> history) = 0;
+    virtual size_t droppedChunks() const = 0;
     virtual bool isOpen() const = 0;
     virtual void close() = 0;
 };
 
+/**
+ * @brief Client output queue drained by a single writer coroutine
+ *
+ * Chunks are written in order, several per write, and never copied. The
+ * queue holds at most queueDepth chunks; beyond that the slow-client policy
+ * decides what gives. The history replayed on connect is written first and
+ * does not count against the queue. run() must be spawned once, and exits
+ * after close().
+ */
 template <typename StreamType>
 class ClientWriterImpl : public ClientWriter
 {
   public:
-    ClientWriterImpl(TimedStreamer<StreamType> streamer) :
-        streamer_(std::move(streamer))
-    {}
+    ClientWriterImpl(TimedStreamer<StreamType> streamer, size_t queueDepth,
+                     SlowClientPolicy policy) :
+        streamer_(std::move(streamer)), wake_(streamer_.socket->get_executor()),
+        queueDepth_(queueDepth), policy_(policy)
+    {
+        wake_.expires_at(net::steady_timer::time_point::max());
+    }
 
-    net::awaitable<void> write(const std::vector<char>& data) override
+    bool enqueue(ConsoleChunk chunk) override
     {
-        auto [ec, bytes] =
-            co_await streamer_.write(boost::asio::buffer(data), false);
-        if (ec)
+        if (closed_)
         {
-            LOG_ERROR("Failed to write to client: {}", ec.message());
+            return false;
         }
+        if (queue_.size() >= queueDepth_)
+        {
+            switch (policy_)
+            {
+                case SlowClientPolicy::DropOldest:
+                    queue_.pop_front();
+                    dropped_++;
+                    break;
+                case SlowClientPolicy::SkipToLive:
+                    dropped_ += queue_.size();
+                    queue_.clear();
+                    break;
+                case SlowClientPolicy::Disconnect:
+                    LOG_WARNING("Client fell {} chunks behind, disconnecting",
+                                queue_.size());
+                    close();
+                    return false;
+            }
+        }
+        queue_.push_back(std::move(chunk));
+        wake_.cancel();
+        return true;
+    }
+
+    void replay(std::vector<ConsoleChunk> history) override
+    {
+        history_.insert(history_.end(),
+                        std::make_move_iterator(history.begin()),
+                        std::make_move_iterator(history.end()));
+        wake_.cancel();
+    }
+
+    net::awaitable<void> run()
+    {
+        std::vector<ConsoleChunk> batch;
+        std::vector<net::const_buffer> buffers;
+        while (!closed_)
+        {
+            if (history_.empty() && queue_.empty())
+            {
+                boost::system::error_code ec;
+                co_await wake_.async_wait(
+                    net::redirect_error(net::use_awaitable, ec));
+                wake_.expires_at(net::steady_timer::time_point::max());
+                continue;
+            }
+            // Take the chunks out of the queue for the write, so the policy
+            // only ever discards chunks that are not being written.
+            while (batch.size() < maxGather)
+            {
+                auto& from = history_.empty() ? queue_ : history_;
+                if (from.empty())
+                {
+                    break;
+                }
+                buffers.push_back(from.front().buffer());
+                batch.push_back(std::move(from.front()));
+                from.pop_front();
+            }
+            auto [ec, bytes] = co_await streamer_.writeAll(buffers, false);
+            batch.clear();
+            buffers.clear();
+            if (ec && !closed_)
+            {
+                LOG_ERROR("Failed to write to client: {}", ec.message());
+                close();
+            }
+        }
+    }
+
+    size_t droppedChunks() const override
+    {
+        return dropped_;
     }
 
     bool isOpen() const override
     {
-        return streamer_.isOpen();
+        return !closed_ && streamer_.isOpen();
     }
 
     void close() override
     {
+        closed_ = true;
+        history_.clear();
+        queue_.clear();
+        wake_.cancel();
         if (streamer_.socket && streamer_.socket->is_open())
         {
             boost::system::error_code ec;
@@ -102,19 +193,33 @@ class ClientWriterImpl : public ClientWriter
     }
 
   private:
+    static constexpr size_t maxGather = 64;
+
     TimedStreamer<StreamType> streamer_;
+    net::steady_timer wake_;
+    std::deque<ConsoleChunk> history_;
+    std::deque<ConsoleChunk> queue_;
+    size_t queueDepth_;
+    SlowClientPolicy policy_;
+    size_t dropped_ = 0;
+    bool closed_ = false;
 };
 
+/**
+ * @brief Console router that handles client connections for a specific device
+ */
 class ConsoleRouter
 {
   public:
-    ConsoleRouter(net::any_io_executor io_context, RingBuffer& ringBuffer,
+    ConsoleRouter(net::any_io_executor io_context, ConsoleHistory& history,
                   std::unique_ptr<UartDevice>& uart,
                   std::unique_ptr<PtyDevice>& pty,
                   std::unique_ptr<SshPtyDevice>& sshPty,
-                  const std::string& name, std::stop_token stopToken) :
-        io_context_(io_context), ringBuffer_(ringBuffer), uart_(uart),
-        pty_(pty), sshPty_(sshPty), consoleName_(name), stopToken_(stopToken)
+                  const BaseDeviceConfig& config, std::stop_token stopToken) :
+        io_context_(io_context), history_(history), uart_(uart),
+        pty_(pty), sshPty_(sshPty), consoleName_(config.name),
+        queueDepth_(config.clientQueueDepth),
+        slowClientPolicy_(config.slowClientPolicy), stopToken_(stopToken)
     {}
 
     /**
@@ -181,28 +286,26 @@ class ConsoleRouter
         int myId = clientId++;
 
         // Add client to list (supports all stream types: Unix socket and
-        // D-Bus)
-        auto clientWriter =
-            std::make_shared<ClientWriterImpl<StreamType>>(streamer);
+        // D-Bus). The history goes out first, straight from the ring, so
+        // live output follows it in order.
+        auto clientWriter = std::make_shared<ClientWriterImpl<StreamType>>(
+            streamer, queueDepth_, slowClientPolicy_);
+        if (!history_.empty())
+        {
+            LOG_DEBUG("Sending History");
+            clientWriter->replay(history_.replay());
+        }
+        boost::asio::co_spawn(
+            io_context_,
+            [clientWriter]() -> net::awaitable<void> {
+                co_await clientWriter->run();
+            },
+            boost::asio::detached);
         clients_.push_back(clientWriter);
 
         LOG_INFO("[{}] Client {} connected (total clients: {})", consoleName_,
                  myId, clients_.size());
 
-        // Send console history to new client
-        if (!ringBuffer_.empty())
-        {
-            LOG_DEBUG("Sending History");
-            std::vector<char> history(ringBuffer_.begin(), ringBuffer_.end());
-            auto [ec, bytes] =
-                co_await streamer.write(boost::asio::buffer(history));
-            if (ec)
-            {
-                LOG_ERROR("[{}] Failed to send history to client {}: {}",
-                          consoleName_, myId, ec.message());
-            }
-        }
-
         // Read from client and forward to UART
         std::array<char, 1024> buffer;
         while (!stopToken_.stop_requested())
@@ -265,17 +368,21 @@ class ConsoleRouter
             }
         }
 
-        // Remove this client from the list
+        // Remove this client from the list and stop its writer
         removeClient(clientWriter);
-        LOG_INFO("[{}] Client {} disconnected (remaining clients: {})",
-                 consoleName_, myId, clients_.size());
+        clientWriter->close();
+        LOG_INFO(
+            "[{}] Client {} disconnected (remaining clients: {}, chunks dropped: {})",
+            consoleName_, myId, clients_.size(), clientWriter->droppedChunks());
     }
 
     /**
      * @brief Broadcast data to all connected clients (Unix socket and
      * D-Bus)
+     *
+     * Every client queues the same chunk; nothing is copied per client.
      */
-    void broadcastToAll(const std::vector<char>& data)
+    void broadcastToAll(const ConsoleChunk& chunk)
     {
         // Remove closed clients before broadcasting
         removeClosedClients();
@@ -283,8 +390,7 @@ class ConsoleRouter
         // Broadcast to all remaining clients
         for (auto& client : clients_)
         {
-            boost::asio::co_spawn(io_context_, client->write(data),
-                                  boost::asio::detached);
+            client->enqueue(chunk);
         }
     }
 
@@ -339,13 +445,15 @@ class ConsoleRouter
     }
 
     net::any_io_executor io_context_;
-    RingBuffer& ringBuffer_;
+    ConsoleHistory& history_;
     std::vector<std::shared_ptr<ClientWriter>> clients_;
     std::vector<int> fdsToClose_;
     std::unique_ptr<UartDevice>& uart_;
     std::unique_ptr<PtyDevice>& pty_;
     std::unique_ptr<SshPtyDevice>& sshPty_;
     std::string consoleName_;
+    size_t queueDepth_;
+    SlowClientPolicy slowClientPolicy_;
     std::stop_token stopToken_;
 };
 
@@ -360,9 +468,9 @@ class ConsoleInstance
                     std::shared_ptr<sdbusplus::asio::connection> sharedBus) :
         io_context_(io_context), deviceConfig_(deviceConfig),
         acceptor_(io_context, deviceConfig.getSocketPath()),
-        ringBuffer_(128 * 1024), // 128KB buffer
-        router_(io_context, ringBuffer_, uart_, pty_, sshPty_,
-                deviceConfig.getName(), stopSource_.get_token()),
+        history_(deviceConfig.base.historySize, deviceConfig.base.historyFile),
+        router_(io_context, history_, uart_, pty_, sshPty_,
+                deviceConfig.base, stopSource_.get_token()),
         server_(io_context, acceptor_, router_), bus_(sharedBus),
         stopToken_(stopSource_.get_token())
     {}
@@ -593,13 +701,10 @@ class ConsoleInstance
     template <typename ReadFunc>
     net::awaitable<void> deviceReadLoop(ReadFunc readFunc)
     {
-        std::array<char, 1024> buffer;
-
         while (!stopToken_.stop_requested())
         {
-            // Read from device (UART or PTY)
-            auto [readEc,
-                  bytesRead] = co_await readFunc(boost::asio::buffer(buffer));
+            // Read from device (UART or PTY) straight into the history
+            auto [readEc, bytesRead] = co_await readFunc(history_.writable());
 
             if (readEc)
             {
@@ -617,14 +722,9 @@ class ConsoleInstance
 
             if (bytesRead > 0)
             {
-                std::vector<char> data(buffer.begin(),
-                                       buffer.begin() + bytesRead);
-
-                // Add to ringbuffer
-                ringBuffer_.insert(ringBuffer_.end(), data.begin(), data.end());
-
-                // Broadcast to all clients (Unix socket and D-Bus)
-                router_.broadcastToAll(data);
+                // Broadcast to all clients (Unix socket and D-Bus) the
+                // bytes now in the history, without copying them
+                router_.broadcastToAll(history_.commit(bytesRead));
             }
         }
     }
@@ -821,7 +921,7 @@ class ConsoleInstance
     net::any_io_executor io_context_;
     DeviceConfig deviceConfig_;
     UnixStreamTypePlain acceptor_;
-    RingBuffer ringBuffer_;
+    ConsoleHistory history_;
     std::unique_ptr<UartDevice> uart_;
     std::unique_ptr<PtyDevice> pty_;
     std::unique_ptr<SshPtyDevice> sshPty_;
@@ -11,8 +11,8 @@ using namespace reactor;
 using json = nlohmann::json;
 
 // Global proxy state with RedfishClient
-// RedfishClient creates fresh connections per request and handles token refresh
-// automatically
+// RedfishClient reuses pooled connections to the target and handles token
+// refresh automatically
 struct ProxyState
 {
     std::unique_ptr<ssl::context> sslContext;
@@ -134,9 +134,24 @@ net::awaitable<Response> handleConfigEndpoint(Request& req,
     co_return res;
 }
 
-// Handler to forward Redfish requests to the configured target server
-net::awaitable<Response> handleProxyRequest(Request& req,
-                                            const http_function& params)
+// Fields that describe one hop of the connection and are not relayed.
+static bool isHopByHop(std::string_view name)
+{
+    return beast::iequals(name, "connection") ||
+           beast::iequals(name, "keep-alive") ||
+           beast::iequals(name, "transfer-encoding") ||
+           beast::iequals(name, "upgrade") || beast::iequals(name, "te") ||
+           beast::iequals(name, "trailer") ||
+           beast::iequals(name, "proxy-connection");
+}
+
+// Handler to forward Redfish requests to the configured target server. The
+// target's response is relayed as it arrives: its header is passed on as soon
+// as it is read and each piece of the body is written to the client before
+// the next one is read from the target, so large responses are not buffered
+// and a slow client slows down the read from the target.
+net::awaitable<StreamResponse> handleProxyRequest(Request& req,
+                                                  const http_function& params)
 {
     LOG_INFO("Proxy handler called for: {} {}",
              std::string(req.method_string()), std::string(req.target()));
@@ -160,34 +175,33 @@ net::awaitable<Response> handleProxyRequest(Request& req,
 
     try
     {
-        // Prepare request to forward - use original request target
-        // Keep-alive set to false to avoid connection timeout issues
+        // Prepare request to forward - use original request target.
+        // Connections to the target are pooled; one closed by the target
+        // while idle is detected and replaced by the client.
         RedfishClient::Request clientReq;
-        clientReq.withMethod(req.method())
-            .withTarget(std::string(req.target()))
-            .withBody(req.body())
-            .witKeepAlive(false); // Disable keep-alive due to server timeouts
+        clientReq.withMethod(req.method()).withTarget(std::string(req.target()));
+        clientReq.body = std::move(req.body());
 
         // Copy relevant headers from original request
-        std::map<std::string, std::string> headers;
         for (const auto& field : req)
         {
-            std::string name = std::string(field.name_string());
-            std::string value = std::string(field.value());
-
-            // Skip host and authorization headers as they will be set by client
-            if (name != "host" && name != "Host" && name != "authorization" &&
-                name != "Authorization" && name != "X-Auth-Token")
+            auto name = field.name_string();
+
+            // Skip host and authorization headers as they will be set by
+            // client, and the per hop ones
+            if (!beast::iequals(name, "host") &&
+                !beast::iequals(name, "authorization") &&
+                !beast::iequals(name, "x-auth-token") &&
+                !beast::iequals(name, "content-length") && !isHopByHop(name))
             {
-                headers[name] = value;
+                clientReq.headers.emplace(name, field.value());
             }
         }
-        clientReq.withHeaders(headers);
 
-        // Execute the forwarded request using stored client
-        // Client creates fresh WebClient per request and handles token refresh
-        // automatically
-        auto [ec, targetRes] = co_await proxyState.client->execute(clientReq);
+        // Client leases a pooled connection per request and handles token
+        // refresh automatically
+        auto [ec, upstream] =
+            co_await proxyState.client->executeStreamed(clientReq);
 
         if (ec)
         {
@@ -200,21 +214,34 @@ net::awaitable<Response> handleProxyRequest(Request& req,
             LOG_ERROR("Request forwarding failed: {}", ec.message());
             co_return res;
         }
+        LOG_DEBUG("Forwarding {} - Status: {}", std::string(req.target()),
+                  upstream->header().result_int());
 
-        // Forward the response from target server
-        res.result(targetRes.result());
-        res.body() = targetRes.body();
-
-        // Copy response headers
-        for (const auto& field : targetRes)
+        StreamedResponse streamed{{upstream->header().result(), req.version()}};
+        for (const auto& field : upstream->header())
         {
-            res.set(field.name_string(), field.value());
+            if (!isHopByHop(field.name_string()))
+            {
+                streamed.header.insert(field.name_string(), field.value());
+            }
         }
-
-        res.prepare_payload();
-        LOG_DEBUG("Forwarded request to {} - Status: {}",
-                  std::string(req.target()),
-                  static_cast<int>(targetRes.result()));
+        if (upstream->done())
+        {
+            // Nothing follows the header (HEAD, 204, 304): send it as is,
+            // including any Content-Length it announces.
+            Response empty{std::move(streamed.header)};
+            co_return empty;
+        }
+        streamed.nextBuffer =
+            [upstream]() -> net::awaitable<std::optional<net::const_buffer>> {
+            auto [ec, piece] = co_await upstream->next();
+            if (ec)
+            {
+                throw boost::system::system_error(ec);
+            }
+            co_return piece;
+        };
+        co_return streamed;
     }
     catch (const std::exception& e)
     {
@@ -286,7 +313,7 @@ int main(int argc, const char* argv[])
         // Set fallback handler to catch all unmatched requests
         // This will forward any Redfish request that doesn't match the config
         // endpoint
-        router.set_fallback_handler(handleProxyRequest);
+        router.set_streaming_fallback_handler(handleProxyRequest);
 
         // Create acceptor and server
         TcpStreamType acceptor(ioc.get_executor(), port, ctx);
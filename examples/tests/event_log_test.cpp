@@ -0,0 +1,190 @@
+#include "event_log.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace NSNAME;
+
+namespace
+{
+
+void expect(bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+// A fresh, empty log directory that is removed again afterwards.
+struct TempDir
+{
+    TempDir()
+    {
+        std::string pattern = std::filesystem::temp_directory_path() /
+                              "event_log_test.XXXXXX";
+        if (::mkdtemp(pattern.data()) == nullptr)
+        {
+            throw std::runtime_error("Unable to create temporary directory");
+        }
+        path = pattern;
+    }
+    ~TempDir()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+    std::filesystem::path path;
+};
+
+// Segment files of the log in dir, in order.
+std::vector<std::filesystem::path> segments(const std::filesystem::path& dir)
+{
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir))
+    {
+        if (entry.path().extension() == ".log")
+        {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+EventLog::Events replay(const std::filesystem::path& dir)
+{
+    net::io_context io;
+    EventLog::Events live;
+    EventLog log(io.get_executor(), live, dir);
+    return log.replay();
+}
+
+// Adds and removes are replayed in order.
+void testReplay()
+{
+    TempDir dir;
+    net::io_context io;
+    EventLog::Events live{{1, "first"}, {3, "third"}};
+    {
+        EventLog log(io.get_executor(), live, dir.path);
+        log.append(1, "first");
+        log.append(2, "second");
+        log.append(3, "third");
+        log.remove(2);
+        expect(log.sync(), "Expected sync to succeed");
+    }
+    expect(replay(dir.path) == live, "Expected replay to restore events");
+}
+
+// A record torn by a crash is dropped, the segment is cut back to the last
+// good record, and appending resumes after it.
+void testReplayAfterTruncatedRecord()
+{
+    TempDir dir;
+    net::io_context io;
+    EventLog::Events live;
+    {
+        EventLog log(io.get_executor(), live, dir.path);
+        log.append(1, "first");
+        log.append(2, "second");
+        expect(log.sync(), "Expected sync to succeed");
+    }
+    auto files = segments(dir.path);
+    expect(files.size() == 1, "Expected one segment");
+    auto size = std::filesystem::file_size(files[0]);
+    std::filesystem::resize_file(files[0], size - 3);
+
+    {
+        EventLog log(io.get_executor(), live, dir.path);
+        auto events = log.replay();
+        expect(events == EventLog::Events{{1, "first"}},
+               "Expected the torn record to be dropped");
+        expect(std::filesystem::file_size(files[0]) < size - 3,
+               "Expected the torn tail to be truncated");
+        log.append(3, "third");
+        expect(log.sync(), "Expected sync after replay to succeed");
+    }
+    expect(replay(dir.path) == EventLog::Events{{1, "first"}, {3, "third"}},
+           "Expected records appended after the cut to replay");
+}
+
+// A record whose checksum does not match is treated like a torn one.
+void testReplayAfterCorruptRecord()
+{
+    TempDir dir;
+    net::io_context io;
+    EventLog::Events live;
+    {
+        EventLog log(io.get_executor(), live, dir.path);
+        log.append(1, "first");
+        log.append(2, "second");
+        expect(log.sync(), "Expected sync to succeed");
+    }
+    auto files = segments(dir.path);
+    {
+        std::fstream file(files[0],
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put('X');
+    }
+    expect(replay(dir.path) == EventLog::Events{{1, "first"}},
+           "Expected the corrupt record to be dropped");
+}
+
+// Compaction leaves one segment holding only the live events; unfinished
+// snapshots and files that are not segments are ignored.
+void testCompactAndStrayFiles()
+{
+    TempDir dir;
+    net::io_context io;
+    EventLog::Events live;
+    {
+        EventLog log(io.get_executor(), live, dir.path);
+        for (uint64_t id = 1; id <= 10; id++)
+        {
+            live[id] = "event" + std::to_string(id);
+            log.append(id, live[id]);
+        }
+        for (uint64_t id = 1; id <= 8; id++)
+        {
+            live.erase(id);
+            log.remove(id);
+        }
+        expect(log.compact(), "Expected compaction to succeed");
+    }
+    expect(segments(dir.path).size() == 1,
+           "Expected compaction to leave one segment");
+    std::ofstream(dir.path / "segment-00000099.log.tmp") << "partial";
+    std::ofstream(dir.path / "segment-abc.log") << "stray";
+
+    expect(replay(dir.path) == live, "Expected compacted log to replay");
+    expect(!std::filesystem::exists(dir.path / "segment-00000099.log.tmp"),
+           "Expected the unfinished snapshot to be removed");
+}
+
+} // namespace
+
+int main()
+{
+    try
+    {
+        testReplay();
+        testReplayAfterTruncatedRecord();
+        testReplayAfterCorruptRecord();
+        testCompactAndStrayFiles();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
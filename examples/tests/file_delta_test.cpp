@@ -0,0 +1,225 @@
+#include "eventmethods.hpp"
+#include "logger.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+using namespace NSNAME;
+#include "file_delta.hpp"
+
+namespace
+{
+
+void expect(bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+std::string readFile(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), {}};
+}
+
+void writeFile(const std::filesystem::path& path, const std::string& data)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << data;
+}
+
+std::string randomBytes(std::mt19937& rng, std::size_t size)
+{
+    std::string data(size, '\0');
+    for (auto& c : data)
+    {
+        c = static_cast<char>(rng());
+    }
+    return data;
+}
+
+// The sender's file and the receiver's copy of it, under a fresh temporary
+// directory. The receiver keeps its copy at root + path, as FileSync does.
+struct DeltaFiles
+{
+    DeltaFiles()
+    {
+        std::string pattern = std::filesystem::temp_directory_path() /
+                              "file_delta_test.XXXXXX";
+        if (::mkdtemp(pattern.data()) == nullptr)
+        {
+            throw std::runtime_error("Unable to create temporary directory");
+        }
+        dir = pattern;
+        source = dir / "source.bin";
+        root = (dir / "root").string();
+        copy = root + source.string();
+        std::filesystem::create_directories(copy.parent_path());
+    }
+    ~DeltaFiles()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+    std::filesystem::path dir;
+    std::filesystem::path source;
+    std::string root;
+    std::filesystem::path copy;
+};
+
+// Runs FetchDelta over TLS on loopback between one sender and one receiver,
+// the way FileSync does, and returns once both sides are done.
+class DeltaRoundTrip
+{
+  public:
+    DeltaRoundTrip() :
+        serverContext(ssl::context::tls_server),
+        clientContext(ssl::context::tls_client),
+        signatures(io.get_executor())
+    {
+        serverContext.use_certificate_chain_file(CERT_DIR "/server-cert.pem");
+        serverContext.use_private_key_file(CERT_DIR "/server-key.pem",
+                                           ssl::context::pem);
+    }
+
+    void run(const DeltaFiles& files)
+    {
+        tcp::acceptor acceptor(io, {tcp::v4(), 0});
+        senderResult = receiverResult = {};
+        finished = 0;
+        net::co_spawn(io, sender(acceptor), net::detached);
+        net::co_spawn(io, receiver(acceptor.local_endpoint(), files),
+                      net::detached);
+        // The signature cache keeps watching files, so io never runs out
+        // of work on its own.
+        while (finished < 2)
+        {
+            io.run_one();
+        }
+        expect(!senderResult, "Sender failed: " + senderResult.message());
+        expect(!receiverResult,
+               "Receiver failed: " + receiverResult.message());
+    }
+
+  private:
+    net::awaitable<void> sender(tcp::acceptor& acceptor)
+    {
+        auto executor = co_await net::this_coro::executor;
+        auto stream = std::make_shared<ssl::stream<tcp::socket>>(
+            co_await acceptor.async_accept(net::use_awaitable),
+            serverContext);
+        co_await stream->async_handshake(ssl::stream_base::server,
+                                         net::use_awaitable);
+        Streamer streamer(stream,
+                          std::make_shared<net::steady_timer>(executor));
+        auto [ec, header] = co_await readHeader(streamer);
+        auto [id, path] = parseEvent(header);
+        senderResult = ec ? ec : co_await sendDelta(streamer, path);
+        finished++;
+    }
+
+    net::awaitable<void> receiver(tcp::endpoint endpoint,
+                                  const DeltaFiles& files)
+    {
+        auto executor = co_await net::this_coro::executor;
+        auto stream = std::make_shared<ssl::stream<tcp::socket>>(
+            executor, clientContext);
+        co_await stream->next_layer().async_connect(endpoint,
+                                                    net::use_awaitable);
+        co_await stream->async_handshake(ssl::stream_base::client,
+                                         net::use_awaitable);
+        Streamer streamer(stream,
+                          std::make_shared<net::steady_timer>(executor));
+        auto signature = co_await signatures.get(files.copy.string());
+        expect(signature != nullptr, "Expected a signature of the copy");
+        co_await sendHeader(
+            streamer, std::format("FetchDelta:{}", files.source.string()));
+        receiverResult = co_await recieveDelta(
+            streamer, files.root, files.source.string(), *signature,
+            signatures);
+        finished++;
+    }
+
+    net::io_context io;
+    ssl::context serverContext;
+    ssl::context clientContext;
+    SignatureCache signatures;
+    boost::system::error_code senderResult;
+    boost::system::error_code receiverResult;
+    int finished{0};
+};
+
+// Give the receiver oldContents, the sender newContents, and check the
+// receiver ends up with newContents.
+void expectRoundTrip(DeltaRoundTrip& roundTrip, const std::string& oldContents,
+                     const std::string& newContents, const std::string& name)
+{
+    DeltaFiles files;
+    writeFile(files.copy, oldContents);
+    writeFile(files.source, newContents);
+    roundTrip.run(files);
+    expect(readFile(files.copy) == newContents,
+           "Expected " + name + " to round trip");
+    std::size_t entries = 0;
+    for ([[maybe_unused]] const auto& entry :
+         std::filesystem::directory_iterator(files.copy.parent_path()))
+    {
+        entries++;
+    }
+    expect(entries == 1, "Expected no temporary file left after " + name);
+}
+
+void testEdit(DeltaRoundTrip& roundTrip, const std::string& base)
+{
+    std::string edited = base;
+    edited.replace(base.size() / 2, 10, "EDITEDTEXT");
+    expectRoundTrip(roundTrip, base, edited, "an edit");
+}
+
+void testInsert(DeltaRoundTrip& roundTrip, const std::string& base)
+{
+    std::string inserted = base;
+    inserted.insert(base.size() / 3, "inserted bytes");
+    expectRoundTrip(roundTrip, base, inserted, "an insert");
+}
+
+void testAppend(DeltaRoundTrip& roundTrip, const std::string& base,
+                std::mt19937& rng)
+{
+    expectRoundTrip(roundTrip, base, base + randomBytes(rng, 5000),
+                    "an append");
+}
+
+void testIdentical(DeltaRoundTrip& roundTrip, const std::string& base)
+{
+    expectRoundTrip(roundTrip, base, base, "an identical file");
+}
+
+} // namespace
+
+int main()
+{
+    try
+    {
+        std::mt19937 rng(1);
+        std::string base = randomBytes(rng, 256 * 1024);
+        DeltaRoundTrip roundTrip;
+        testEdit(roundTrip, base);
+        testInsert(roundTrip, base);
+        testAppend(roundTrip, base, rng);
+        testIdentical(roundTrip, base);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "http_server.hpp"
+#include "logger.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace NSNAME;
+
+namespace
+{
+
+void expect(bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+using ClientStream = ssl::stream<tcp::socket>;
+
+net::awaitable<http::response<http::string_body>>
+    get(ClientStream& stream, beast::flat_buffer& buffer,
+        const std::string& target)
+{
+    http::request<http::empty_body> req{http::verb::get, target, 11};
+    req.set(http::field::host, "localhost");
+    co_await http::async_write(stream, req, net::use_awaitable);
+    http::response<http::string_body> res;
+    co_await http::async_read(stream, buffer, res, net::use_awaitable);
+    co_return res;
+}
+
+// Whether the server closed the connection: the next read gets no data.
+net::awaitable<bool> closedByServer(ClientStream& stream,
+                                    beast::flat_buffer& buffer)
+{
+    http::response<http::string_body> res;
+    boost::system::error_code ec;
+    co_await http::async_read(stream, buffer, res,
+                              net::redirect_error(net::use_awaitable, ec));
+    co_return ec.failed();
+}
+
+net::awaitable<void> client(tcp::endpoint endpoint, ssl::context& context,
+                            bool& done)
+{
+    auto executor = co_await net::this_coro::executor;
+    ClientStream stream(executor, context);
+    co_await stream.next_layer().async_connect(endpoint, net::use_awaitable);
+    co_await stream.async_handshake(ssl::stream_base::client,
+                                    net::use_awaitable);
+    beast::flat_buffer buffer;
+
+    // Responses built with the shared helpers keep the connection open,
+    // for successes and errors alike.
+    auto first = co_await get(stream, buffer, "/hello");
+    expect(first.result() == http::status::ok && first.body() == "hello",
+           "Expected the first request to be served");
+    expect(first.keep_alive(), "Expected the first response to keep alive");
+
+    auto second = co_await get(stream, buffer, "/hello");
+    expect(second.result() == http::status::ok && second.body() == "hello",
+           "Expected the second request on the same socket to be served");
+
+    auto missing = co_await get(stream, buffer, "/missing");
+    expect(missing.result() == http::status::not_found &&
+               missing.keep_alive(),
+           "Expected a 404 to keep the connection open");
+
+    auto error = co_await get(stream, buffer, "/error");
+    expect(error.result() == http::status::bad_request && error.keep_alive(),
+           "Expected an error response to keep the connection open");
+
+    // A handler can still close the connection explicitly.
+    auto last = co_await get(stream, buffer, "/close");
+    expect(last.result() == http::status::ok && !last.keep_alive(),
+           "Expected the opt-out to answer with Connection: close");
+    expect(co_await closedByServer(stream, buffer),
+           "Expected the server to close after the opt-out");
+    done = true;
+}
+
+} // namespace
+
+int main()
+{
+    try
+    {
+        net::io_context io;
+        ssl::context serverContext(ssl::context::tls_server);
+        serverContext.use_certificate_chain_file(CERT_DIR "/server-cert.pem");
+        serverContext.use_private_key_file(CERT_DIR "/server-key.pem",
+                                           ssl::context::pem);
+        ssl::context clientContext(ssl::context::tls_client);
+
+        HttpRouter router;
+        router.add_get_handler(
+            "/hello", [](Request& req, const http_function&) -> Response {
+                return make_success_response("hello", http::status::ok,
+                                             req.version());
+            });
+        router.add_get_handler(
+            "/error", [](Request& req, const http_function&) -> Response {
+                return make_bad_request_error("bad", req.version());
+            });
+        router.add_get_handler(
+            "/close", [](Request& req, const http_function&) -> Response {
+                auto res = make_success_response("bye", http::status::ok,
+                                                 req.version());
+                res.keep_alive(false);
+                return res;
+            });
+
+        TcpStreamType acceptor(io.get_executor(), 0, serverContext);
+        HttpServer server(io, acceptor, router);
+        tcp::endpoint endpoint(net::ip::address_v4::loopback(),
+                               acceptor.acceptor_.local_endpoint().port());
+
+        bool done = false;
+        net::co_spawn(io, client(endpoint, clientContext, done),
+                      [&io](std::exception_ptr error) {
+                          io.stop();
+                          if (error)
+                          {
+                              std::rethrow_exception(error);
+                          }
+                      });
+        io.run();
+        expect(done, "Expected the client to finish");
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "route_trie.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace NSNAME;
+
+namespace
+{
+
+void expect(bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+// "{name}" segments match any single segment and are captured by name.
+void testParamCapture()
+{
+    RouteTrie<int> trie;
+    trie["/redfish/v1/Systems/{SystemId}"] = 1;
+    trie["/redfish/v1/Systems/{SystemId}/LogServices/{LogId}"] = 2;
+
+    RouteParams params;
+    int* found = trie.match("/redfish/v1/Systems/system0", params);
+    expect(found != nullptr && *found == 1, "Expected member route to match");
+    expect(params.size() == 1, "Expected one captured parameter");
+    expect(params["SystemId"] == "system0",
+           "Expected parameter value from the request path");
+
+    found = trie.match("/redfish/v1/Systems/system0/LogServices/EventLog",
+                       params);
+    expect(found != nullptr && *found == 2, "Expected nested route to match");
+    expect(params.size() == 2, "Expected two captured parameters");
+    expect(params["SystemId"] == "system0" && params["LogId"] == "EventLog",
+           "Expected both parameters to be captured");
+    expect(params["Missing"].empty(),
+           "Expected an unknown parameter name to be empty");
+}
+
+// A literal segment wins over a parameter at the same position.
+void testLiteralOverParam()
+{
+    RouteTrie<int> trie;
+    trie["/redfish/v1/Systems/{SystemId}"] = 1;
+    trie["/redfish/v1/Systems/Settings"] = 2;
+
+    RouteParams params;
+    int* found = trie.match("/redfish/v1/Systems/Settings", params);
+    expect(found != nullptr && *found == 2, "Expected literal route to win");
+    expect(params.size() == 0, "Expected no parameters for literal route");
+
+    found = trie.match("/redfish/v1/Systems/system0", params);
+    expect(found != nullptr && *found == 1,
+           "Expected other segments to match the parameter route");
+    expect(params["SystemId"] == "system0",
+           "Expected parameter capture next to a literal sibling");
+}
+
+// A literal branch that dead-ends falls back to the parameter branch.
+void testBacktracking()
+{
+    RouteTrie<int> trie;
+    trie["/a/b/d"] = 1;
+    trie["/a/{x}/c"] = 2;
+
+    RouteParams params;
+    int* found = trie.match("/a/b/c", params);
+    expect(found != nullptr && *found == 2,
+           "Expected match through the parameter after the literal failed");
+    expect(params.size() == 1 && params["x"] == "b",
+           "Expected only the parameter of the matched route");
+}
+
+void testNoMatch()
+{
+    RouteTrie<int> trie;
+    trie["/redfish/v1/Systems/{SystemId}"] = 1;
+
+    RouteParams params;
+    expect(trie.match("/redfish/v1/Systems", params) == nullptr,
+           "Expected a missing segment not to match");
+    expect(trie.match("/redfish/v1/Systems/system0/Extra", params) == nullptr,
+           "Expected an extra segment not to match");
+    expect(trie.match("/redfish/v1/Chassis/chassis0", params) == nullptr,
+           "Expected a different literal not to match");
+}
+
+// Registering the same path again returns the same slot.
+void testRegistration()
+{
+    RouteTrie<int> trie;
+    trie["/redfish/v1"] = 1;
+    trie["/redfish/v1/Systems"] = 2;
+    trie["/redfish/v1"] = 3;
+
+    RouteParams params;
+    int* found = trie.match("/redfish/v1", params);
+    expect(found != nullptr && *found == 3, "Expected the slot to be reused");
+    expect(trie.size() == 2, "Expected two distinct routes");
+}
+
+} // namespace
+
+int main()
+{
+    try
+    {
+        testParamCapture();
+        testLiteralOverParam();
+        testBacktracking();
+        testNoMatch();
+        testRegistration();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "eventmethods.hpp"
+#include "logger.hpp"
+#include "socket_streams.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+using namespace NSNAME;
+#include "event_file_methods.hpp"
+
+namespace
+{
+
+void expect(bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+using PlainStreamer = TimedStreamer<unix_domain::socket>;
+
+// An unlinked temporary file holding data; the caller owns the descriptor.
+int makeFile(const std::string& data)
+{
+    std::string path = std::filesystem::temp_directory_path() /
+                       "send_file_test.XXXXXX";
+    int fd = ::mkostemp(path.data(), O_CLOEXEC);
+    if (fd == -1)
+    {
+        throw std::runtime_error("Unable to create temporary file");
+    }
+    ::unlink(path.c_str());
+    if (::write(fd, data.data(), data.size()) !=
+        static_cast<ssize_t>(data.size()))
+    {
+        ::close(fd);
+        throw std::runtime_error("Unable to write temporary file");
+    }
+    return fd;
+}
+
+std::string randomBytes(std::size_t size)
+{
+    std::mt19937 rng(static_cast<unsigned>(size));
+    std::string data(size, '\0');
+    for (auto& c : data)
+    {
+        c = static_cast<char>(rng());
+    }
+    return data;
+}
+
+// Refuses sendfile the way a file system without splice support does, so
+// sendFileBlocks has to copy the file a block at a time.
+struct NoSendfileStreamer
+{
+    using stream_type = unix_domain::socket;
+
+    AwaitableResult<std::size_t> sendFile(int, std::uint64_t, std::size_t,
+                                          bool)
+    {
+        co_return std::make_pair(
+            make_error_code(boost::system::errc::operation_not_supported),
+            std::size_t{0});
+    }
+    template <typename ConstBufferSequence>
+    AwaitableResult<std::size_t> writeAll(const ConstBufferSequence& buffers,
+                                          bool timeout)
+    {
+        co_return co_await streamer.writeAll(buffers, timeout);
+    }
+
+    PlainStreamer streamer;
+};
+
+// A connected pair of plain sockets; the sending end is wrapped in a
+// TimedStreamer and the other end is read back by the test.
+struct SocketPair
+{
+    explicit SocketPair(net::io_context& io) :
+        sender(std::make_shared<unix_domain::socket>(io)),
+        receiver(std::make_shared<unix_domain::socket>(io)),
+        streamer(sender, std::make_shared<net::steady_timer>(io))
+    {
+        net::local::connect_pair(*sender, *receiver);
+    }
+
+    // Read until the sender closes its end.
+    net::awaitable<std::string> readAll()
+    {
+        std::string data;
+        std::array<char, 16 * 1024> buffer{};
+        while (true)
+        {
+            boost::system::error_code ec;
+            auto n = co_await receiver->async_read_some(
+                net::buffer(buffer),
+                net::redirect_error(net::use_awaitable, ec));
+            data.append(buffer.data(), n);
+            if (ec)
+            {
+                co_return data;
+            }
+        }
+    }
+
+    std::shared_ptr<unix_domain::socket> sender;
+    std::shared_ptr<unix_domain::socket> receiver;
+    PlainStreamer streamer;
+};
+
+// Run send and read the other end of sockets at the same time, then return
+// what was read.
+template <typename Send>
+std::string transfer(net::io_context& io, SocketPair& sockets, Send send)
+{
+    std::string received;
+    net::co_spawn(
+        io,
+        [&]() -> net::awaitable<void> {
+            co_await send();
+            sockets.sender->close();
+        },
+        [](std::exception_ptr error) {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        });
+    net::co_spawn(
+        io,
+        [&]() -> net::awaitable<void> {
+            received = co_await sockets.readAll();
+        },
+        net::detached);
+    io.restart();
+    io.run();
+    return received;
+}
+
+// More than the socket buffer holds, so sendfile runs into EAGAIN and has
+// to wait for the reader.
+void testLargeFile()
+{
+    net::io_context io;
+    SocketPair sockets(io);
+    std::string data = randomBytes(8 * 1024 * 1024);
+    FileDescriptor file(makeFile(data));
+    boost::system::error_code ec;
+    std::size_t sent = 0;
+    auto received = transfer(io, sockets, [&]() -> net::awaitable<void> {
+        std::tie(ec, sent) =
+            co_await sockets.streamer.sendFile(file.get(), 0, data.size());
+    });
+    expect(!ec, "Expected sendfile to succeed: " + ec.message());
+    expect(sent == data.size(), "Expected the whole file to be sent");
+    expect(received == data, "Expected the receiver to get the file");
+}
+
+// Asking for more than the file holds ends with eof after the last byte.
+void testShortFile()
+{
+    net::io_context io;
+    SocketPair sockets(io);
+    std::string data = randomBytes(1000);
+    FileDescriptor file(makeFile(data));
+    boost::system::error_code ec;
+    std::size_t sent = 0;
+    auto received = transfer(io, sockets, [&]() -> net::awaitable<void> {
+        std::tie(ec, sent) =
+            co_await sockets.streamer.sendFile(file.get(), 0, 2000);
+    });
+    expect(ec == net::error::eof, "Expected eof for a short file");
+    expect(sent == data.size() && received == data,
+           "Expected the bytes the file has to be sent");
+}
+
+// sendFileBlocks on a plain socket goes through sendfile.
+void testSendFileBlocks()
+{
+    net::io_context io;
+    SocketPair sockets(io);
+    std::string data = randomBytes(300 * 1024);
+    boost::system::error_code ec;
+    auto received = transfer(io, sockets, [&]() -> net::awaitable<void> {
+        ec = co_await sendFileBlocks(sockets.streamer, makeFile(data),
+                                     static_cast<off_t>(data.size()));
+    });
+    expect(!ec, "Expected sendFileBlocks to succeed: " + ec.message());
+    expect(received == data, "Expected the receiver to get the file");
+}
+
+// When sendfile is not supported, sendFileBlocks copies the file by blocks.
+void testSendFileBlocksFallback()
+{
+    net::io_context io;
+    SocketPair sockets(io);
+    std::string data = randomBytes(300 * 1024);
+    NoSendfileStreamer streamer{sockets.streamer};
+    boost::system::error_code ec;
+    auto received = transfer(io, sockets, [&]() -> net::awaitable<void> {
+        ec = co_await sendFileBlocks(streamer, makeFile(data),
+                                     static_cast<off_t>(data.size()));
+    });
+    expect(!ec, "Expected the block copy to succeed: " + ec.message());
+    expect(received == data, "Expected the block copy to send the file");
+}
+
+} // namespace
+
+int main()
+{
+    try
+    {
+        testLargeFile();
+        testShortFile();
+        testSendFileBlocks();
+        testSendFileBlocksFallback();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+// Converts the per-thread ring files written by Tracer (trace.hpp) into the
+// Chrome trace event format, for chrome://tracing or ui.perfetto.dev:
+//
+//   REACTOR_TRACE_DIR=/tmp/trace redfishproxy ...
+//   trace_decoder /tmp/trace/trace.* > trace.json
+//
+// Spans become async events keyed by their id, so the requests of one
+// connection line up even though a reactor thread interleaves many.
+#include "beastdefs.hpp"
+#include "trace.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace NSNAME;
+
+// What arg0 and arg1 mean for each event; empty names are not emitted.
+struct ArgNames
+{
+    const char* arg0;
+    const char* arg1;
+};
+
+ArgNames argNames(TraceEvent event)
+{
+    switch (event)
+    {
+        case TraceEvent::Connection: return {"", ""};
+        case TraceEvent::Handshake:  return {"", "failed"};
+        case TraceEvent::Request:    return {"method", ""};
+        case TraceEvent::Route:      return {"", "status"};
+        case TraceEvent::Write:      return {"", "failed"};
+        case TraceEvent::Task:       return {"", "failed"};
+        case TraceEvent::EventSend:  return {"size", "failed"};
+    }
+    return {"arg0", "arg1"};
+}
+
+nlohmann::json argValue(TraceEvent event, std::uint64_t value)
+{
+    if (event == TraceEvent::Request)
+    {
+        return std::string(http::to_string(static_cast<http::verb>(value)));
+    }
+    return value;
+}
+
+nlohmann::json toChrome(const TraceFileHeader& header, const TraceRecord& r)
+{
+    auto event = static_cast<TraceEvent>(r.event);
+    const char* ph = "n";
+    if (r.phase == static_cast<std::uint8_t>(TracePhase::Begin))
+    {
+        ph = "b";
+    }
+    else if (r.phase == static_cast<std::uint8_t>(TracePhase::End))
+    {
+        ph = "e";
+    }
+    nlohmann::json out = {{"name", traceEventName(event)},
+                          {"cat", "reactor"},
+                          {"ph", ph},
+                          {"id", std::format("{:#x}", r.id)},
+                          {"ts", static_cast<double>(r.timestampNs) / 1000.0},
+                          {"pid", header.pid},
+                          {"tid", r.tid}};
+    ArgNames names = argNames(event);
+    nlohmann::json args = nlohmann::json::object();
+    if (*names.arg0 != '\0' && r.arg0 != 0)
+    {
+        args[names.arg0] = argValue(event, r.arg0);
+    }
+    if (*names.arg1 != '\0' && r.phase != static_cast<std::uint8_t>(
+                                              TracePhase::Begin))
+    {
+        args[names.arg1] = r.arg1;
+    }
+    if (!args.empty())
+    {
+        out["args"] = std::move(args);
+    }
+    return out;
+}
+
+// Append the records of one file, oldest first, to events.
+bool decode(const std::string& path, nlohmann::json& events)
+{
+    std::ifstream file(path, std::ios::binary);
+    TraceFileHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != TraceFileHeader::expectedMagic ||
+        header.recordSize != sizeof(TraceRecord) || header.capacity == 0)
+    {
+        std::cerr << path << ": not a trace file\n";
+        return false;
+    }
+    std::vector<TraceRecord> records(header.capacity);
+    file.read(reinterpret_cast<char*>(records.data()),
+              static_cast<std::streamsize>(records.size() *
+                                           sizeof(TraceRecord)));
+    std::uint64_t first =
+        header.count > header.capacity ? header.count - header.capacity : 0;
+    for (std::uint64_t n = first; n < header.count; n++)
+    {
+        events.push_back(toChrome(header, records[n % header.capacity]));
+    }
+    std::cerr << std::format("{}: {} records{}\n", path, header.count - first,
+                             first != 0 ? " (older ones overwritten)" : "");
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: trace_decoder TRACE_FILE... > trace.json\n";
+        return 1;
+    }
+    nlohmann::json events = nlohmann::json::array();
+    bool ok = true;
+    for (int i = 1; i < argc; i++)
+    {
+        ok = decode(argv[i], events) && ok;
+    }
+    std::cout << nlohmann::json{{"traceEvents", std::move(events)},
+                                {"displayTimeUnit", "ns"}}
+                     .dump()
+              << '\n';
+    return ok ? 0 : 1;
+}
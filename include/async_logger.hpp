@@ -0,0 +1,278 @@
+#pragma once
+#include "name_space.hpp"
+
+#include <systemd/sd-journal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace NSNAME
+{
+
+// Log backend that hands formatted lines to a background writer instead of
+// writing them on the calling thread. Lines go into a bounded ring of fixed
+// size records (the Vyukov scheme of BoundedMpmcQueue in worker.hpp, with
+// the record written in place), so queueing a line never blocks or
+// allocates once warm: a full ring drops the line and a line longer than a
+// record is cut. Together with Logger::logFormat, which formats into a per
+// thread buffer, an enabled LOG_* line then costs no allocation.
+// The writer drains whatever is queued in one write() per batch, or sends
+// it to the journal, and reports drops in the log itself.
+template <std::size_t Capacity = 4096, std::size_t RecordSize = 512>
+class AsyncRingLogger
+{
+    static_assert(std::has_single_bit(Capacity));
+
+  public:
+    enum class Sink
+    {
+        Fd,
+        Journal
+    };
+
+    struct Stats
+    {
+        std::uint64_t written;
+        std::uint64_t dropped;
+        std::uint64_t truncated;
+    };
+
+    explicit AsyncRingLogger(Sink sink = Sink::Fd, int fd = STDERR_FILENO) :
+        sink(sink), fd(fd)
+    {
+        for (std::size_t i = 0; i < Capacity; i++)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        writer = std::thread([this] { run(); });
+    }
+    AsyncRingLogger(const AsyncRingLogger&) = delete;
+    AsyncRingLogger& operator=(const AsyncRingLogger&) = delete;
+
+    // Writes out everything queued before returning.
+    ~AsyncRingLogger()
+    {
+        stopping.store(true);
+        wake();
+        writer.join();
+    }
+
+    AsyncRingLogger& operator<<(std::string_view data)
+    {
+        pending() += data;
+        return *this;
+    }
+
+    void flush(int priority)
+    {
+        std::string& line = pending();
+        push(line, priority);
+        line.clear();
+    }
+
+    Stats stats() const
+    {
+        return {written.load(std::memory_order_relaxed),
+                dropped.load(std::memory_order_relaxed),
+                truncated.load(std::memory_order_relaxed)};
+    }
+
+  private:
+    static constexpr std::size_t textSize =
+        RecordSize - sizeof(std::atomic<std::size_t>) - 2 * sizeof(int);
+
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        int priority;
+        int size;
+        char text[textSize];
+    };
+
+    // Lines are assembled per thread, so concurrent loggers don't interleave.
+    static std::string& pending()
+    {
+        thread_local std::string line;
+        return line;
+    }
+
+    void push(std::string_view line, int priority)
+    {
+        auto pos = tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = cells[pos & (Capacity - 1)];
+            auto seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+                {
+                    if (line.size() > textSize)
+                    {
+                        truncated.fetch_add(1, std::memory_order_relaxed);
+                        line = line.substr(0, textSize);
+                    }
+                    std::memcpy(cell.text, line.data(), line.size());
+                    cell.size = static_cast<int>(line.size());
+                    cell.priority = priority;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else
+            {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        // Pairs with the fence in run(): either the writer sees this record
+        // before it sleeps, or we see it asleep and wake it.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed))
+        {
+            wake();
+        }
+    }
+
+    void wake()
+    {
+        wakeups.fetch_add(1, std::memory_order_release);
+        wakeups.notify_one();
+    }
+
+    // Only the writer thread pops, so head needs no CAS.
+    Cell* front()
+    {
+        auto pos = head.load(std::memory_order_relaxed);
+        Cell& cell = cells[pos & (Capacity - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+        {
+            return nullptr;
+        }
+        return &cell;
+    }
+
+    void pop(Cell& cell)
+    {
+        auto pos = head.load(std::memory_order_relaxed);
+        cell.sequence.store(pos + Capacity, std::memory_order_release);
+        head.store(pos + 1, std::memory_order_relaxed);
+    }
+
+    void run()
+    {
+        std::string batch;
+        std::uint64_t reportedDrops = 0;
+        while (true)
+        {
+            auto epoch = wakeups.load(std::memory_order_acquire);
+            std::size_t count = 0;
+            while (Cell* cell = front())
+            {
+                std::string_view text(cell->text,
+                                      static_cast<std::size_t>(cell->size));
+                if (sink == Sink::Journal)
+                {
+                    sd_journal_send("MESSAGE=%.*s", cell->size, cell->text,
+                                    "PRIORITY=%i", cell->priority, NULL);
+                }
+                else
+                {
+                    batch += text;
+                    batch += '\n';
+                }
+                pop(*cell);
+                count++;
+                if (batch.size() >= 64 * 1024)
+                {
+                    writeOut(batch);
+                }
+            }
+            if (auto drops = dropped.load(std::memory_order_relaxed);
+                drops != reportedDrops)
+            {
+                std::string note = std::format(
+                    "[Warning] logger: ring full, {} lines dropped",
+                    drops - reportedDrops);
+                reportedDrops = drops;
+                if (sink == Sink::Journal)
+                {
+                    sd_journal_send("MESSAGE=%s", note.c_str(), "PRIORITY=%i",
+                                    4, NULL);
+                }
+                else
+                {
+                    batch += note;
+                    batch += '\n';
+                }
+            }
+            writeOut(batch);
+            written.fetch_add(count, std::memory_order_relaxed);
+            if (count != 0)
+            {
+                continue;
+            }
+            if (stopping.load())
+            {
+                return;
+            }
+            sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (front() == nullptr && !stopping.load())
+            {
+                wakeups.wait(epoch, std::memory_order_acquire);
+            }
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    void writeOut(std::string& batch)
+    {
+        std::string_view rest = batch;
+        while (!rest.empty())
+        {
+            auto n = ::write(fd, rest.data(), rest.size());
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                break; // nowhere left to report it
+            }
+            rest.remove_prefix(static_cast<std::size_t>(n));
+        }
+        batch.clear();
+    }
+
+    Sink sink;
+    int fd;
+    std::unique_ptr<Cell[]> cells{new Cell[Capacity]};
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+    alignas(64) std::atomic<std::uint32_t> wakeups{0};
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<std::uint64_t> written{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> truncated{0};
+    std::thread writer;
+};
+
+} // namespace NSNAME
@@ -0,0 +1,291 @@
+#pragma once
+#include "http_client.hpp"
+#include "logger.hpp"
+
+#include <sys/socket.h>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+namespace NSNAME
+{
+
+/**
+ * @brief Keep-alive HTTPS connections, keyed by host, port and TLS context.
+ *
+ * One pool exists per io_context (it is an Asio service, see
+ * getConnectionPool), so it needs no locking and its sockets are released
+ * before the io_context goes away. At most maxPerHost connections are open
+ * to one key; further acquire() calls wait for a lease to come back.
+ * Connections idle for longer than idleTimeout are closed.
+ *
+ * An idle connection is checked before it is handed out: a peer that has
+ * closed it, or sent anything while it was idle, makes it unusable. The
+ * check cannot catch a close that is still in flight, so callers retry once
+ * on a fresh connection when a reused one fails (see WebClient::execute).
+ */
+class ConnectionPool : public net::execution_context::service
+{
+  public:
+    using Client = HttpClient<beast::tcp_stream>;
+    static inline net::execution_context::id id;
+
+    struct Key
+    {
+        std::string host;
+        std::string port;
+        ssl::context* ctx;
+        auto operator<=>(const Key&) const = default;
+    };
+
+    // Exclusive use of a pooled connection. It goes back to the pool when
+    // the lease is destroyed if keepAlive() was called, else it is closed.
+    class Lease
+    {
+      public:
+        Lease() = default;
+        Lease(ConnectionPool* pool, Key key, std::unique_ptr<Client> client,
+              bool reused) :
+            pool(pool), key(std::move(key)), connection(std::move(client)),
+            wasReused(reused)
+        {}
+        Lease(Lease&& other) noexcept :
+            pool(std::exchange(other.pool, nullptr)),
+            key(std::move(other.key)), connection(std::move(other.connection)),
+            wasReused(other.wasReused), keep(other.keep)
+        {}
+        Lease& operator=(Lease&& other) noexcept
+        {
+            if (this != &other)
+            {
+                giveBack();
+                pool = std::exchange(other.pool, nullptr);
+                key = std::move(other.key);
+                connection = std::move(other.connection);
+                wasReused = other.wasReused;
+                keep = other.keep;
+            }
+            return *this;
+        }
+        ~Lease()
+        {
+            giveBack();
+        }
+
+        Client& client()
+        {
+            return *connection;
+        }
+        // True if the connection served an earlier request.
+        bool reused() const
+        {
+            return wasReused;
+        }
+        void keepAlive()
+        {
+            keep = true;
+        }
+
+      private:
+        void giveBack()
+        {
+            if (pool && connection)
+            {
+                pool->release(key, std::move(connection), keep);
+            }
+            pool = nullptr;
+        }
+        ConnectionPool* pool{nullptr};
+        Key key;
+        std::unique_ptr<Client> connection;
+        bool wasReused{false};
+        bool keep{false};
+    };
+
+    explicit ConnectionPool(net::io_context& ioc) :
+        net::execution_context::service(ioc), ioc(ioc), sweepTimer(ioc)
+    {}
+
+    void setMaxPerHost(std::size_t count)
+    {
+        maxPerHost = count;
+    }
+    void setIdleTimeout(std::chrono::seconds timeout)
+    {
+        idleTimeout = timeout;
+    }
+    void setAcquireTimeout(std::chrono::seconds timeout)
+    {
+        acquireTimeout = timeout;
+    }
+
+    net::awaitable<std::pair<boost::system::error_code, Lease>> acquire(
+        ssl::context& ctx, const std::string& host, const std::string& port)
+    {
+        Key key{host, port, &ctx};
+        auto& entry = hosts[key];
+        while (true)
+        {
+            // Newest first: it is the least likely to have been closed.
+            while (!entry.idle.empty())
+            {
+                auto idle = std::move(entry.idle.back());
+                entry.idle.pop_back();
+                if (Clock::now() - idle.since < idleTimeout &&
+                    healthy(*idle.client))
+                {
+                    co_return std::make_pair(
+                        boost::system::error_code{},
+                        Lease(this, key, std::move(idle.client), true));
+                }
+                LOG_DEBUG("Dropping stale connection to {}:{}", host, port);
+                entry.open--;
+            }
+            if (entry.open < maxPerHost)
+            {
+                break;
+            }
+            auto waiter = std::make_shared<net::steady_timer>(ioc);
+            waiter->expires_after(acquireTimeout);
+            entry.waiters.push_back(waiter);
+            boost::system::error_code ec;
+            co_await waiter->async_wait(
+                net::redirect_error(net::use_awaitable, ec));
+            if (ec != net::error::operation_aborted)
+            {
+                LOG_ERROR("Timed out waiting for a connection to {}:{}", host,
+                          port);
+                co_return std::make_pair(
+                    boost::system::error_code{net::error::timed_out},
+                    Lease{});
+            }
+        }
+        entry.open++;
+        auto client = std::make_unique<Client>(ioc, ctx);
+        auto ec = co_await client->connect(host, port);
+        if (ec)
+        {
+            release(key, nullptr, false);
+            co_return std::make_pair(ec, Lease{});
+        }
+        co_return std::make_pair(ec,
+                                 Lease(this, key, std::move(client), false));
+    }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+    struct Idle
+    {
+        std::unique_ptr<Client> client;
+        Clock::time_point since;
+    };
+    struct Host
+    {
+        std::size_t open{0}; // leased and idle
+        std::vector<Idle> idle;
+        std::deque<std::weak_ptr<net::steady_timer>> waiters;
+    };
+
+    void shutdown() override
+    {
+        stopped = true;
+        sweepTimer.cancel();
+        hosts.clear();
+    }
+
+    void release(const Key& key, std::unique_ptr<Client> client, bool keep)
+    {
+        if (stopped)
+        {
+            return;
+        }
+        auto& entry = hosts[key];
+        if (keep && client)
+        {
+            entry.idle.push_back({std::move(client), Clock::now()});
+            scheduleSweep();
+        }
+        else
+        {
+            entry.open--;
+        }
+        // Wake the oldest waiter that is still waiting.
+        while (!entry.waiters.empty())
+        {
+            auto waiter = entry.waiters.front().lock();
+            entry.waiters.pop_front();
+            if (waiter)
+            {
+                waiter->cancel();
+                break;
+            }
+        }
+    }
+
+    // A healthy idle connection has nothing to read: end of stream means the
+    // peer closed it, and data means it is out of sync.
+    static bool healthy(Client& client)
+    {
+        auto& socket = client.getLowestLayer().socket();
+        if (!socket.is_open())
+        {
+            return false;
+        }
+        char byte = 0;
+        auto n = ::recv(socket.native_handle(), &byte, 1,
+                        MSG_PEEK | MSG_DONTWAIT);
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    void scheduleSweep()
+    {
+        if (sweeping)
+        {
+            return;
+        }
+        sweeping = true;
+        sweepTimer.expires_after(idleTimeout);
+        sweepTimer.async_wait([this](const boost::system::error_code& ec) {
+            sweeping = false;
+            if (ec)
+            {
+                return;
+            }
+            bool anyIdle = false;
+            auto now = Clock::now();
+            for (auto& [key, entry] : hosts)
+            {
+                std::erase_if(entry.idle, [&](const Idle& idle) {
+                    bool expired = now - idle.since >= idleTimeout;
+                    entry.open -= expired;
+                    return expired;
+                });
+                anyIdle = anyIdle || !entry.idle.empty();
+            }
+            if (anyIdle)
+            {
+                scheduleSweep();
+            }
+        });
+    }
+
+    net::io_context& ioc;
+    net::steady_timer sweepTimer;
+    std::map<Key, Host> hosts;
+    std::size_t maxPerHost{8};
+    std::chrono::seconds idleTimeout{30};
+    std::chrono::seconds acquireTimeout{30};
+    bool sweeping{false};
+    bool stopped{false};
+};
+
+// The connection pool of an io_context, created on first use.
+inline ConnectionPool& getConnectionPool(net::io_context& ioc)
+{
+    return net::use_service<ConnectionPool>(ioc);
+}
+} // namespace NSNAME
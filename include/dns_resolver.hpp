@@ -0,0 +1,325 @@
+#pragma once
+#include "file_descriptor.hpp"
+#include "logger.hpp"
+#include "make_awaitable.hpp"
+#include "worker.hpp"
+
+#include <netdb.h>
+#include <sys/eventfd.h>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+namespace NSNAME
+{
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+using namespace std::chrono_literals;
+
+/**
+ * @brief Process wide cache of host name lookups.
+ *
+ * getaddrinfo runs on the WorkerPool, so a slow DNS server never blocks an
+ * io_context. The io thread waits on an eventfd that the worker signals;
+ * unlike posting back into the io_context this is safe when Asio is built
+ * without thread support. Concurrent lookups of the same name share one
+ * getaddrinfo call.
+ *
+ * getaddrinfo does not report record TTLs, so results are kept for a fixed
+ * time. Failures are cached for a shorter time, so a name that does not
+ * resolve is not looked up again for every connection attempt.
+ */
+class DnsCache
+{
+  public:
+    using Endpoints = std::vector<tcp::endpoint>;
+
+    void setTtl(std::chrono::seconds positive, std::chrono::seconds negative)
+    {
+        std::lock_guard lock(mutex);
+        positiveTtl = positive;
+        negativeTtl = negative;
+    }
+    void clear()
+    {
+        std::lock_guard lock(mutex);
+        entries.clear();
+    }
+
+    AwaitableResult<Endpoints> resolve(const std::string& host,
+                                       const std::string& port)
+    {
+        if (auto literal = numericEndpoint(host, port))
+        {
+            co_return std::make_tuple(boost::system::error_code{},
+                                      Endpoints{*literal});
+        }
+        auto key = host + '\n' + port;
+        std::shared_ptr<Lookup> lookup;
+        {
+            std::lock_guard lock(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end())
+            {
+                if (std::chrono::steady_clock::now() < it->second.expires)
+                {
+                    co_return std::make_tuple(it->second.ec,
+                                              it->second.endpoints);
+                }
+                entries.erase(it);
+            }
+            auto& current = pending[key];
+            if (!current)
+            {
+                current = std::make_shared<Lookup>(host, port);
+                start(key, current);
+            }
+            lookup = current;
+        }
+        co_return co_await wait(*lookup);
+    }
+
+  private:
+    struct Entry
+    {
+        boost::system::error_code ec;
+        Endpoints endpoints;
+        std::chrono::steady_clock::time_point expires;
+    };
+    struct Lookup
+    {
+        Lookup(std::string host, std::string port) :
+            host(std::move(host)), port(std::move(port)),
+            done(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+        {}
+        std::string host;
+        std::string port;
+        // Becomes readable once the result is set; never read, so every
+        // waiter sees it.
+        FileDescriptor done;
+        std::mutex mutex;
+        boost::system::error_code ec;
+        Endpoints endpoints;
+    };
+
+    static std::optional<tcp::endpoint> numericEndpoint(const std::string& host,
+                                                        const std::string& port)
+    {
+        boost::system::error_code ec;
+        auto address = net::ip::make_address(host, ec);
+        uint16_t portNumber = 0;
+        auto [ptr, err] = std::from_chars(
+            port.data(), port.data() + port.size(), portNumber);
+        if (ec || err != std::errc{} || ptr != port.data() + port.size())
+        {
+            return std::nullopt;
+        }
+        return tcp::endpoint(address, portNumber);
+    }
+
+    static boost::system::error_code toErrorCode(int rc)
+    {
+        switch (rc)
+        {
+            case EAI_NONAME:
+            case EAI_NODATA:
+                return net::error::host_not_found;
+            case EAI_AGAIN:
+                return net::error::host_not_found_try_again;
+            case EAI_SERVICE:
+                return net::error::service_not_found;
+            case EAI_SYSTEM:
+                return {errno, boost::system::system_category()};
+            default:
+                return net::error::no_recovery;
+        }
+    }
+
+    void start(const std::string& key, std::shared_ptr<Lookup> lookup)
+    {
+        getWorkerPool().addTask([this, key, lookup = std::move(lookup)] {
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = AI_ADDRCONFIG;
+            addrinfo* info = nullptr;
+            auto rc = ::getaddrinfo(lookup->host.c_str(), lookup->port.c_str(),
+                                    &hints, &info);
+            Endpoints endpoints;
+            boost::system::error_code ec;
+            if (rc == 0)
+            {
+                for (auto* ai = info; ai != nullptr; ai = ai->ai_next)
+                {
+                    tcp::endpoint endpoint;
+                    endpoint.resize(ai->ai_addrlen);
+                    std::memcpy(endpoint.data(), ai->ai_addr, ai->ai_addrlen);
+                    endpoints.push_back(endpoint);
+                }
+                ::freeaddrinfo(info);
+            }
+            else
+            {
+                ec = toErrorCode(rc);
+            }
+            {
+                std::lock_guard lock(mutex);
+                auto ttl = ec ? negativeTtl : positiveTtl;
+                entries[key] = {ec, endpoints,
+                                std::chrono::steady_clock::now() + ttl};
+                pending.erase(key);
+            }
+            {
+                std::lock_guard lock(lookup->mutex);
+                lookup->ec = ec;
+                lookup->endpoints = std::move(endpoints);
+            }
+            uint64_t one = 1;
+            [[maybe_unused]] auto n = ::write(lookup->done.get(), &one, 8);
+        });
+    }
+
+    static AwaitableResult<Endpoints> wait(Lookup& lookup)
+    {
+        net::posix::stream_descriptor done(co_await net::this_coro::executor,
+                                           ::dup(lookup.done.get()));
+        boost::system::error_code ec;
+        co_await done.async_wait(net::posix::stream_descriptor::wait_read,
+                                 net::redirect_error(net::use_awaitable, ec));
+        if (ec)
+        {
+            co_return std::make_tuple(ec, Endpoints{});
+        }
+        std::lock_guard lock(lookup.mutex);
+        co_return std::make_tuple(lookup.ec, lookup.endpoints);
+    }
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<std::string, std::shared_ptr<Lookup>> pending;
+    std::chrono::seconds positiveTtl{30};
+    std::chrono::seconds negativeTtl{5};
+};
+
+inline DnsCache& getDnsCache()
+{
+    static DnsCache cache;
+    return cache;
+}
+
+/**
+ * @brief Connect to the first of the endpoints that answers (RFC 8305).
+ *
+ * Addresses are tried alternating between IPv6 and IPv4, starting with the
+ * family the resolver listed first. A new attempt starts when the previous
+ * one fails or after attemptDelay, without cancelling the attempts already
+ * running; the first to connect is moved into socket and the others are
+ * closed. Fails with timed_out if nothing connects within timeout. The
+ * connected socket has TCP_NODELAY set.
+ */
+inline net::awaitable<boost::system::error_code> connectEndpoints(
+    tcp::socket& socket, const DnsCache::Endpoints& endpoints,
+    std::chrono::steady_clock::duration timeout,
+    std::chrono::steady_clock::duration attemptDelay = 250ms)
+{
+    struct Race
+    {
+        explicit Race(net::any_io_executor executor) : wake(executor) {}
+        net::steady_timer wake;
+        std::vector<std::shared_ptr<tcp::socket>> attempts;
+        std::optional<tcp::socket> winner;
+        boost::system::error_code lastError{net::error::host_not_found};
+        std::size_t running{0};
+    };
+    auto executor = co_await net::this_coro::executor;
+    auto race = std::make_shared<Race>(executor);
+
+    std::vector<tcp::endpoint> order;
+    std::vector<tcp::endpoint> first;
+    std::vector<tcp::endpoint> second;
+    for (const auto& endpoint : endpoints)
+    {
+        bool sameFamily = endpoint.protocol() == endpoints.front().protocol();
+        (sameFamily ? first : second).push_back(endpoint);
+    }
+    for (std::size_t i = 0; i < std::max(first.size(), second.size()); i++)
+    {
+        if (i < first.size())
+        {
+            order.push_back(first[i]);
+        }
+        if (i < second.size())
+        {
+            order.push_back(second[i]);
+        }
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::size_t next = 0;
+    while (!race->winner && std::chrono::steady_clock::now() < deadline)
+    {
+        if (next < order.size())
+        {
+            auto attempt = std::make_shared<tcp::socket>(executor);
+            race->attempts.push_back(attempt);
+            race->running++;
+            attempt->async_connect(
+                order[next++],
+                [race, attempt](const boost::system::error_code& ec) {
+                    race->running--;
+                    if (!ec && !race->winner)
+                    {
+                        race->winner.emplace(std::move(*attempt));
+                    }
+                    else if (ec && ec != net::error::operation_aborted)
+                    {
+                        race->lastError = ec;
+                    }
+                    race->wake.cancel();
+                });
+            race->wake.expires_at(
+                std::min(deadline, std::chrono::steady_clock::now() +
+                                       attemptDelay));
+        }
+        else if (race->running == 0)
+        {
+            break;
+        }
+        else
+        {
+            race->wake.expires_at(deadline);
+        }
+        boost::system::error_code ec;
+        co_await race->wake.async_wait(
+            net::redirect_error(net::use_awaitable, ec));
+    }
+    for (auto& attempt : race->attempts)
+    {
+        boost::system::error_code ec;
+        attempt->close(ec);
+    }
+    if (!race->winner)
+    {
+        co_return race->running > 0 || next < order.size()
+            ? net::error::timed_out
+            : race->lastError;
+    }
+    socket = std::move(*race->winner);
+    // Requests are written as a few small records (an abbreviated TLS
+    // handshake ends with one); Nagle would hold them for the peer's ACK.
+    boost::system::error_code ignored;
+    socket.set_option(tcp::no_delay(true), ignored);
+    co_return boost::system::error_code{};
+}
+} // namespace NSNAME
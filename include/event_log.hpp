@@ -0,0 +1,567 @@
+#pragma once
+#include "file_descriptor.hpp"
+#include "logger.hpp"
+#include "make_awaitable.hpp"
+#include "worker.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+namespace NSNAME
+{
+static constexpr auto EVENTLOGDIR = "/var/lib/coroserver/eventlog";
+
+/**
+ * @brief Append-only, CRC framed write-ahead log of EventQueue changes.
+ *
+ * Every addEvent and removeEvent appends one record:
+ *
+ *     u32 payload size | u32 crc32 | u8 type | u64 event id | payload
+ *
+ * The CRC covers type, id and payload. Records are buffered and written
+ * with one write() and one fdatasync() per commit interval (group commit),
+ * so a burst of events costs one sync, and at most one interval of changes
+ * is lost on a crash. Commits run on getFileWorkerPool(), one at a time, and
+ * report back through an eventfd, so the io thread never waits for the disk;
+ * records added meanwhile go into the next commit.
+ *
+ * The log lives in numbered segment files. Once the log holds much more
+ * than the live events, it is compacted: the live set is written to a new
+ * segment, which is synced and renamed into place, and the older segments
+ * are deleted. Replay reads the segments in order. It stops at the first
+ * torn or corrupt record of a segment and truncates the last segment there,
+ * so appending can resume.
+ */
+class EventLog
+{
+  public:
+    using Events = std::map<uint64_t, std::string>;
+
+    // live is the caller's view of the pending events; it is read when the
+    // log is compacted.
+    EventLog(net::any_io_executor executor, const Events& live,
+             std::string dir = EVENTLOGDIR) :
+        directory(std::move(dir)), live(live), commitTimer(executor),
+        commitWait(executor, ::dup(commitDone.get()))
+    {}
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+    ~EventLog()
+    {
+        sync();
+    }
+
+    void setCommitInterval(std::chrono::milliseconds interval)
+    {
+        commitInterval = interval;
+    }
+    void setSegmentSize(std::size_t bytes)
+    {
+        segmentSize = bytes;
+    }
+
+    // Read every segment and return the events that are still pending.
+    Events replay()
+    {
+        Events events;
+        removeTemporaries();
+        auto segments = listSegments();
+        for (std::size_t i = 0; i < segments.size(); i++)
+        {
+            auto valid = replaySegment(segmentPath(segments[i]), events);
+            if (valid && i + 1 == segments.size())
+            {
+                // Torn tail of the active segment: drop it so new records
+                // are appended after the last good one.
+                std::error_code ec;
+                std::filesystem::resize_file(segmentPath(segments[i]), *valid,
+                                             ec);
+                LOG_WARNING("Truncated event log segment {} at {} bytes",
+                            segments[i], *valid);
+            }
+        }
+        if (!segments.empty())
+        {
+            activeSegment = segments.back();
+        }
+        return events;
+    }
+
+    bool empty() const
+    {
+        return listSegments().empty();
+    }
+
+    void append(uint64_t id, std::string_view event)
+    {
+        addRecord(RecordType::Add, id, event);
+    }
+    void remove(uint64_t id)
+    {
+        addRecord(RecordType::Remove, id, {});
+    }
+
+    // Write and sync everything appended so far before returning. For
+    // startup and shutdown; while running, commits happen in the background.
+    bool sync()
+    {
+        waitCommit();
+        if (pending.empty())
+        {
+            return true;
+        }
+        if (!writeRecords(pending))
+        {
+            return false;
+        }
+        pending.clear();
+        return true;
+    }
+
+    // Rewrite the log as a single segment holding only the live events,
+    // before returning.
+    bool compact()
+    {
+        if (!sync())
+        {
+            return false;
+        }
+        return writeSnapshot(encodeLive());
+    }
+
+  private:
+    enum class RecordType : uint8_t
+    {
+        Add = 1,
+        Remove = 2,
+    };
+    static constexpr std::size_t headerSize = 4 + 4 + 1 + 8;
+
+    static void putU32(std::string& out, uint32_t v)
+    {
+        char b[4];
+        std::memcpy(b, &v, 4);
+        out.append(b, 4);
+    }
+    static void putU64(std::string& out, uint64_t v)
+    {
+        char b[8];
+        std::memcpy(b, &v, 8);
+        out.append(b, 8);
+    }
+    static uint32_t checksum(const char* data, std::size_t size)
+    {
+        return static_cast<uint32_t>(
+            ::crc32(0L, reinterpret_cast<const Bytef*>(data),
+                    static_cast<uInt>(size)));
+    }
+    static void encode(std::string& out, RecordType type, uint64_t id,
+                       std::string_view payload)
+    {
+        auto start = out.size();
+        putU32(out, static_cast<uint32_t>(payload.size()));
+        putU32(out, 0); // crc, patched below
+        out.push_back(static_cast<char>(type));
+        putU64(out, id);
+        out.append(payload);
+        auto crc = checksum(out.data() + start + 8, out.size() - start - 8);
+        std::memcpy(out.data() + start + 4, &crc, 4);
+    }
+
+    void addRecord(RecordType type, uint64_t id, std::string_view payload)
+    {
+        encode(pending, type, id, payload);
+        scheduleCommit();
+    }
+
+    void scheduleCommit()
+    {
+        if (commitScheduled || committing)
+        {
+            return; // a running commit schedules the next one when done
+        }
+        commitScheduled = true;
+        commitTimer.expires_after(commitInterval);
+        commitTimer.async_wait([this, weak = std::weak_ptr<int>(lifetime)](
+                                   const boost::system::error_code& ec) {
+            if (weak.expired())
+            {
+                return;
+            }
+            commitScheduled = false;
+            if (ec)
+            {
+                return;
+            }
+            startCommit();
+        });
+    }
+
+    // Hand the pending records to a file worker, together with a snapshot of
+    // the live events if the log is due for compaction. Until the commit
+    // finishes, the worker owns everything describing the files (fd,
+    // segment numbers and sizes) and the io thread leaves them alone.
+    void startCommit()
+    {
+        if (pending.empty())
+        {
+            return;
+        }
+        commitBatch = std::move(pending);
+        pending.clear();
+        commitSnapshot.reset();
+        // Compact once the log has grown well past its last compacted size,
+        // i.e. when it is mostly records of events already gone.
+        if (logBytes + commitBatch.size() >
+            std::max(compactionFloor, 4 * compactedBytes))
+        {
+            commitSnapshot = encodeLive();
+        }
+        committing = true;
+        commitFinished.store(false, std::memory_order_relaxed);
+        getFileWorkerPool().addTask([this] {
+            commitOk = writeRecords(commitBatch);
+            if (commitOk && commitSnapshot)
+            {
+                writeSnapshot(*commitSnapshot);
+            }
+            uint64_t one = 1;
+            [[maybe_unused]] auto n = ::write(commitDone.get(), &one, 8);
+            // Last touch of the log: once this is seen, it may be destroyed
+            commitFinished.store(true, std::memory_order_release);
+        });
+        awaitCommit();
+    }
+
+    void awaitCommit()
+    {
+        commitWait.async_wait(
+            net::posix::stream_descriptor::wait_read,
+            [this, weak = std::weak_ptr<int>(lifetime)](
+                const boost::system::error_code& ec) {
+                if (weak.expired() || ec || !committing)
+                {
+                    return;
+                }
+                if (!commitFinished.load(std::memory_order_acquire))
+                {
+                    awaitCommit(); // signalled, but not quite done yet
+                    return;
+                }
+                finishCommit();
+            });
+    }
+
+    void finishCommit()
+    {
+        uint64_t count = 0;
+        [[maybe_unused]] auto n = ::read(commitDone.get(), &count, 8);
+        committing = false;
+        if (!commitOk)
+        {
+            // Keep the records for the next attempt
+            pending.insert(0, commitBatch);
+        }
+        commitBatch.clear();
+        commitSnapshot.reset();
+        if (!pending.empty())
+        {
+            scheduleCommit();
+        }
+    }
+
+    // Block until a commit running on a worker is done.
+    void waitCommit()
+    {
+        if (!committing)
+        {
+            return;
+        }
+        while (!commitFinished.load(std::memory_order_acquire))
+        {
+            pollfd wait{commitDone.get(), POLLIN, 0};
+            ::poll(&wait, 1, 10);
+        }
+        commitWait.cancel();
+        finishCommit();
+    }
+
+    std::string encodeLive() const
+    {
+        std::string data;
+        for (const auto& [id, event] : live)
+        {
+            encode(data, RecordType::Add, id, event);
+        }
+        return data;
+    }
+
+    // Append records to the active segment and sync them.
+    bool writeRecords(std::string_view records)
+    {
+        if (!openActive())
+        {
+            return false;
+        }
+        if (!writeAll(fd.get(), records) || ::fdatasync(fd.get()) != 0)
+        {
+            LOG_ERROR("Failed to write event log: {}", strerror(errno));
+            return false;
+        }
+        logBytes += records.size();
+        activeBytes += records.size();
+        if (activeBytes >= segmentSize)
+        {
+            fd.reset();
+            activeSegment++;
+            activeBytes = 0;
+        }
+        return true;
+    }
+
+    // Install data as the only segment.
+    bool writeSnapshot(std::string_view data)
+    {
+        if (!ensureDirectory())
+        {
+            return false;
+        }
+        auto old = listSegments();
+        auto snapshot = activeSegment + 1;
+        auto tmp = segmentPath(snapshot) + ".tmp";
+        FileDescriptor out(
+            ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+        if (out.get() < 0 || !writeAll(out.get(), data) ||
+            ::fdatasync(out.get()) != 0)
+        {
+            LOG_ERROR("Failed to write event log snapshot: {}",
+                      strerror(errno));
+            std::error_code ec;
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+        out.reset();
+        std::error_code ec;
+        std::filesystem::rename(tmp, segmentPath(snapshot), ec);
+        if (ec)
+        {
+            LOG_ERROR("Failed to install event log snapshot: {}", ec.message());
+            return false;
+        }
+        syncDirectory();
+        for (auto segment : old)
+        {
+            std::filesystem::remove(segmentPath(segment), ec);
+        }
+        fd.reset();
+        activeSegment = snapshot + 1;
+        activeBytes = 0;
+        logBytes = compactedBytes = data.size();
+        LOG_DEBUG("Compacted event log to {} bytes", data.size());
+        return true;
+    }
+
+    // Returns the size of the valid prefix if the segment has a bad tail.
+    std::optional<std::size_t> replaySegment(const std::string& path,
+                                             Events& events)
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+        logBytes += data.size();
+        std::size_t pos = 0;
+        while (pos + headerSize <= data.size())
+        {
+            uint32_t size = 0;
+            uint32_t crc = 0;
+            uint64_t id = 0;
+            std::memcpy(&size, data.data() + pos, 4);
+            std::memcpy(&crc, data.data() + pos + 4, 4);
+            if (pos + headerSize + size > data.size() ||
+                checksum(data.data() + pos + 8, 1 + 8 + size) != crc)
+            {
+                LOG_ERROR("Corrupt event log record in {} at offset {}",
+                          path, pos);
+                activeBytes = pos;
+                return pos;
+            }
+            auto type = static_cast<RecordType>(data[pos + 8]);
+            std::memcpy(&id, data.data() + pos + 9, 8);
+            if (type == RecordType::Add)
+            {
+                events[id] = data.substr(pos + headerSize, size);
+            }
+            else
+            {
+                events.erase(id);
+            }
+            pos += headerSize + size;
+        }
+        activeBytes = pos;
+        if (pos != data.size())
+        {
+            return pos;
+        }
+        return std::nullopt;
+    }
+
+    // The number of a segment-<n><suffix> file name; other names, including
+    // ones with a stray non-numeric part, are not segments.
+    static std::optional<uint64_t> segmentNumber(std::string_view name,
+                                                 std::string_view suffix)
+    {
+        if (!name.starts_with("segment-") || !name.ends_with(suffix))
+        {
+            return std::nullopt;
+        }
+        auto number = name.substr(8, name.size() - 8 - suffix.size());
+        uint64_t segment = 0;
+        auto [ptr, ec] = std::from_chars(
+            number.data(), number.data() + number.size(), segment);
+        if (number.empty() || ec != std::errc() ||
+            ptr != number.data() + number.size())
+        {
+            return std::nullopt;
+        }
+        return segment;
+    }
+
+    // Snapshots left half written by a crash during compaction.
+    void removeTemporaries() const
+    {
+        std::error_code ec;
+        for (const auto& entry :
+             std::filesystem::directory_iterator(directory, ec))
+        {
+            auto name = entry.path().filename().string();
+            if (segmentNumber(name, ".log.tmp"))
+            {
+                LOG_WARNING("Removing unfinished event log snapshot {}", name);
+                std::error_code removeEc;
+                std::filesystem::remove(entry.path(), removeEc);
+            }
+        }
+    }
+
+    std::vector<uint64_t> listSegments() const
+    {
+        std::vector<uint64_t> segments;
+        std::error_code ec;
+        for (const auto& entry :
+             std::filesystem::directory_iterator(directory, ec))
+        {
+            auto name = entry.path().filename().string();
+            if (auto segment = segmentNumber(name, ".log"))
+            {
+                segments.push_back(*segment);
+            }
+        }
+        std::sort(segments.begin(), segments.end());
+        return segments;
+    }
+    std::string segmentPath(uint64_t segment) const
+    {
+        return std::format("{}/segment-{:08}.log", directory, segment);
+    }
+    bool ensureDirectory()
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec)
+        {
+            LOG_ERROR("Unable to create directory {}", directory);
+            return false;
+        }
+        return true;
+    }
+    bool openActive()
+    {
+        if (fd.get() >= 0)
+        {
+            return true;
+        }
+        if (!ensureDirectory())
+        {
+            return false;
+        }
+        fd.reset(::open(segmentPath(activeSegment).c_str(),
+                        O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600));
+        if (fd.get() < 0)
+        {
+            LOG_ERROR("Unable to open event log {}: {}",
+                      segmentPath(activeSegment), strerror(errno));
+            return false;
+        }
+        return true;
+    }
+    void syncDirectory()
+    {
+        FileDescriptor dir(::open(directory.c_str(), O_RDONLY | O_DIRECTORY));
+        if (dir.get() >= 0)
+        {
+            ::fsync(dir.get());
+        }
+    }
+    static bool writeAll(int fd, std::string_view data)
+    {
+        while (!data.empty())
+        {
+            auto n = ::write(fd, data.data(), data.size());
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            data.remove_prefix(static_cast<std::size_t>(n));
+        }
+        return true;
+    }
+
+    std::string directory;
+    const Events& live;
+    net::steady_timer commitTimer;
+    std::chrono::milliseconds commitInterval{20};
+    std::size_t segmentSize{4 * 1024 * 1024};
+    std::size_t compactionFloor{1024 * 1024};
+    FileDescriptor fd;
+    std::string pending;
+    uint64_t activeSegment{0};
+    std::size_t activeBytes{0};
+    std::size_t logBytes{0};
+    std::size_t compactedBytes{0};
+    bool commitScheduled{false};
+    // Commit in progress on a file worker
+    FileDescriptor commitDone{::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)};
+    net::posix::stream_descriptor commitWait;
+    bool committing{false};
+    std::atomic<bool> commitFinished{true};
+    bool commitOk{true};
+    std::string commitBatch;
+    std::optional<std::string> commitSnapshot;
+    std::shared_ptr<int> lifetime{std::make_shared<int>(0)};
+};
+} // namespace NSNAME
@@ -8,6 +8,8 @@
 namespace NSNAME
 {
 static constexpr auto DONE = "Done";
+static constexpr auto BATCH = "Batch";
+static constexpr auto ACK = "Ack";
 static constexpr auto HEDER_DELIM = "\r\n\r\n";
 static constexpr auto BUFFER_SIZE = 8192;
 using Streamer = TimedStreamer<ssl::stream<tcp::socket>>;
@@ -79,16 +81,17 @@ inline AwaitableResult<size_t> sendData(Streamer streamer,
 }
 inline AwaitableResult<std::string> readHeader(Streamer streamer)
 {
-    auto [ec, data] = co_await streamer.readUntil(HEDER_DELIM, timeoutneeded);
+    auto [ec, frame] = co_await streamer.readFrame(HEDER_DELIM, timeoutneeded);
     if (ec)
     {
         LOG_INFO("Error reading: {}", ec.message());
-        co_return std::make_pair(ec, data);
+        co_return std::make_pair(ec, std::string{});
     }
     auto delimLength = std::string_view(HEDER_DELIM).length();
-    data.erase(data.length() - delimLength, delimLength);
+    std::string data(frame.substr(0, frame.length() - delimLength));
+    streamer.consume(frame.length());
     LOG_DEBUG("{} Recieved Header: {}", currentTime(), data);
-    co_return std::make_pair(ec, data);
+    co_return std::make_pair(ec, std::move(data));
 }
 inline AwaitableResult<size_t> sendHeader(Streamer streamer,
                                           const std::string& data)
@@ -110,15 +113,17 @@ net::awaitable<boost::system::error_code> sendDone(Streamer streamer)
 }
 AwaitableResult<std::string> readDone(Streamer streamer)
 {
-    auto [ec, data] = co_await streamer.readUntil(HEDER_DELIM, true);
+    auto [ec, frame] = co_await streamer.readFrame(HEDER_DELIM, true);
     if (ec)
     {
         LOG_INFO("Error reading Done: {}", ec.message());
-        co_return std::make_pair(ec, data);
+        co_return std::make_pair(ec, std::string{});
     }
     auto delimLength = std::string_view(HEDER_DELIM).length();
-    data.erase(data.length() - delimLength, delimLength);
+    auto data = frame.substr(0, frame.length() - delimLength);
     LOG_INFO("{} Recieved Header: {}", currentTime(), data);
-    co_return std::make_pair(ec, data);
+    std::string header(data);
+    streamer.consume(frame.length());
+    co_return std::make_pair(ec, std::move(header));
 }
 }
\ No newline at end of file
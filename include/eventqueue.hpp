@@ -1,11 +1,15 @@
 #pragma once
+#include "event_log.hpp"
 #include "eventmethods.hpp"
 #include "serializer.hpp"
 #include "taskqueue.hpp"
 #include "tcp_server.hpp"
 #include "utilities.hpp"
 
+#include <charconv>
+#include <deque>
 #include <map>
+#include <unordered_map>
 namespace NSNAME
 {
 static constexpr auto EVENTQUEFILE = "/var/lib/coroserver/eventqueue2.dat";
@@ -43,7 +47,7 @@ struct EventQueue
                net::ssl::context& sslClientContext, const std::string& url,
                const std::string& port, int maxConnections = 1) :
         taskQueue(ioContext, sslClientContext, url, port, maxConnections),
-        tcpServer(ioContext, acceptor, *this), serializer(EVENTQUEFILE)
+        tcpServer(ioContext, acceptor, *this), eventLog(ioContext, events)
     {
         addEventProvider("default", defaultProvider);
         addEventConsumer("default", defaultConsumer);
@@ -51,15 +55,28 @@ struct EventQueue
     EventQueue(net::any_io_executor ioContext, TcpStreamType& acceptor,
                net::ssl::context& sslClientContext, int maxConnections = 1) :
         taskQueue(ioContext, sslClientContext, maxConnections),
-        tcpServer(ioContext, acceptor, *this), serializer(EVENTQUEFILE)
+        tcpServer(ioContext, acceptor, *this), eventLog(ioContext, events)
     {
         addEventProvider("default", defaultProvider);
         addEventConsumer("default", defaultConsumer);
     }
     void setQueEndPoint(const std::string& ip, const std::string& port)
     {
+        legacyPeer = false;
         taskQueue.setEndPoint(ip, port);
     }
+    // Events without a registered provider never talk back to the consumer,
+    // so they can be pipelined. With a window above zero such events are
+    // sent in batches on one connection: a "Batch:<seq>:<count>" header
+    // followed by the events, coalesced into a single write, with up to
+    // window events unacknowledged. The peer answers each batch with a
+    // cumulative "Ack:<seq>". A peer that predates batching answers the
+    // header and every event with "Done"; it is then sent plain events,
+    // still pipelined. Zero (the default) keeps the lock-step exchange.
+    void setPipelineWindow(std::size_t window)
+    {
+        pipelineWindow = window;
+    }
     auto getQueEndPoint() const
     {
         return taskQueue.getEndPoint();
@@ -86,13 +103,29 @@ struct EventQueue
         buffer << file.rdbuf();
         return buffer.str();
     }
+    // Replay the event log and queue every event that was still pending.
+    // A queue file written by older versions is imported once.
     void load()
     {
-        if (!fs::exists(EVENTQUEFILE))
+        if (eventLog.empty() && fs::exists(EVENTQUEFILE))
         {
-            LOG_INFO("No event queue file found");
+            importQueueFile();
             return;
         }
+        for (auto& [id, event] : eventLog.replay())
+        {
+            events[id] = event;
+            queueEvent(id, event);
+        }
+    }
+    // Make everything logged so far durable. Called on shutdown.
+    void store()
+    {
+        eventLog.sync();
+    }
+    void importQueueFile()
+    {
+        JsonSerializer serializer(EVENTQUEFILE);
         serializer.load();
         std::vector<std::string> events;
         serializer.deserialize("events", events);
@@ -102,16 +135,13 @@ struct EventQueue
             uint64_t id = std::stoull(std::string(eventmap[0]));
             addEvent(std::string(eventmap[1]), id);
         }
-    }
-    void store()
-    {
-        std::vector<std::string> events;
-        for (auto& [id, event] : this->events)
+        if (eventLog.sync())
         {
-            events.push_back(std::to_string(id) + "," + event);
+            std::error_code ec;
+            fs::remove(EVENTQUEFILE, ec);
+            LOG_INFO("Imported {} events from {}", events.size(),
+                     EVENTQUEFILE);
         }
-        serializer.serialize("events", events);
-        serializer.store();
     }
 
     std::string getEventId(std::string_view event)
@@ -125,7 +155,11 @@ struct EventQueue
     }
     void removeEvent(uint64_t id)
     {
-        events.erase(id);
+        unindexEvent(id);
+        if (events.erase(id))
+        {
+            eventLog.remove(id);
+        }
     }
     net::awaitable<boost::system::error_code> executeProvider(
         std::reference_wrapper<EventProvider> provider, Streamer streamer,
@@ -162,11 +196,19 @@ struct EventQueue
         uint64_t id, std::reference_wrapper<EventProvider> provider,
         const std::string& event, Streamer streamer)
     {
+        TraceSpan span(TraceEvent::EventSend, id, event.size());
         boost::system::error_code retCode{};
+        if (!events.contains(id))
+        {
+            // Replaced or expired while it was waiting in the task queue.
+            co_return retCode;
+        }
+        unindexEvent(id);
         auto [ec, size] = co_await streamer.write(net::buffer(event), false);
         if (ec)
         {
             LOG_ERROR("Failed to write to stream: {}", ec.message());
+            span.arg1 = 1;
             resendEvent(id, provider);
             co_return ec;
         }
@@ -175,6 +217,7 @@ struct EventQueue
         if (ec)
         {
             LOG_ERROR("Failed to read header: {}", ec.message());
+            span.arg1 = 1;
             resendEvent(id, provider);
             co_return ec;
         }
@@ -188,6 +231,7 @@ struct EventQueue
 
         if (ec)
         {
+            span.arg1 = 1;
             resendEvent(id, provider);
             co_return ec;
         }
@@ -196,20 +240,161 @@ struct EventQueue
         co_return retCode;
         // co_return ec;
     }
-    void resendEvent(uint64_t id,
-                     std::reference_wrapper<EventProvider> provider)
+    struct InFlight
+    {
+        uint64_t seq;
+        std::optional<uint64_t> id; // empty for a batch header
+    };
+    net::awaitable<boost::system::error_code> sendBatchHandler(
+        Streamer streamer)
+    {
+        std::deque<InFlight> inflight;
+        std::size_t unacked = 0;
+        std::string out;
+        boost::system::error_code ec;
+        while (!pipelined.empty() || !inflight.empty())
+        {
+            // Fill the window and send it as one write.
+            if (unacked < pipelineWindow && !pipelined.empty())
+            {
+                std::vector<uint64_t> ids;
+                while (unacked + ids.size() < pipelineWindow &&
+                       !pipelined.empty())
+                {
+                    if (events.contains(pipelined.front()))
+                    {
+                        ids.push_back(pipelined.front());
+                    }
+                    pipelined.pop_front();
+                }
+                if (ids.empty())
+                {
+                    continue;
+                }
+                out.clear();
+                if (!legacyPeer)
+                {
+                    out += makeEvent(
+                        BATCH, std::format("{}:{}", nextSeq, ids.size()));
+                    inflight.push_back({nextSeq, std::nullopt});
+                }
+                for (auto id : ids)
+                {
+                    unindexEvent(id);
+                    out += events[id];
+                    inflight.push_back({nextSeq++, id});
+                }
+                unacked += ids.size();
+                for (std::size_t sent = 0; !ec && sent < out.size();)
+                {
+                    std::size_t bytes = 0;
+                    std::tie(ec, bytes) = co_await streamer.write(
+                        net::buffer(out.data() + sent, out.size() - sent),
+                        false);
+                    sent += bytes;
+                }
+                if (ec)
+                {
+                    LOG_ERROR("Failed to write batch: {}", ec.message());
+                    break;
+                }
+                continue;
+            }
+
+            std::string header;
+            std::tie(ec, header) = co_await readHeader(streamer);
+            if (ec)
+            {
+                LOG_ERROR("Failed to read acknowledgement: {}", ec.message());
+                break;
+            }
+            if (header == DONE && !inflight.empty())
+            {
+                // Older peer: one Done per header and per event, in order.
+                legacyPeer = true;
+                if (auto id = inflight.front().id)
+                {
+                    removeEvent(*id);
+                    --unacked;
+                }
+                inflight.pop_front();
+                continue;
+            }
+            auto [ackId, ackSeq] = parseEvent(header);
+            uint64_t acked = 0;
+            if (ackId != ACK ||
+                std::from_chars(ackSeq.data(), ackSeq.data() + ackSeq.size(),
+                                acked)
+                        .ec != std::errc{})
+            {
+                LOG_ERROR("Unexpected reply to batch: {}", header);
+                ec = boost::asio::error::connection_reset;
+                break;
+            }
+            while (!inflight.empty() && inflight.front().seq <= acked)
+            {
+                if (auto id = inflight.front().id)
+                {
+                    removeEvent(*id);
+                    --unacked;
+                }
+                inflight.pop_front();
+            }
+        }
+        if (ec)
+        {
+            // Unacknowledged events go back in front, in their order.
+            for (auto it = inflight.rbegin(); it != inflight.rend(); ++it)
+            {
+                if (it->id && !expired(*it->id))
+                {
+                    indexEvent(*it->id);
+                    pipelined.push_front(*it->id);
+                }
+            }
+        }
+        batchActive = false;
+        if (!pipelined.empty())
+        {
+            scheduleBatch(true);
+        }
+        co_return ec;
+    }
+    void scheduleBatch(bool front = false)
+    {
+        if (batchActive)
+        {
+            return;
+        }
+        batchActive = true;
+        taskQueue.addTask(
+            std::bind_front(&EventQueue::sendBatchHandler, this), front);
+    }
+    // Drops the event when it has outlived TIMETOLIVE.
+    bool expired(uint64_t id)
     {
-        const auto& event = events[id];
         auto now = epocNow();
         auto time_diff = std::chrono::duration_cast<std::chrono::seconds>(
                              std::chrono::milliseconds(now - id))
                              .count();
         if (time_diff > TIMETOLIVE)
         {
-            LOG_ERROR("Exceeded time to live for the event: {}", event);
+            LOG_ERROR("Exceeded time to live for the event: {}", events[id]);
             removeEvent(id);
+            return true;
+        }
+        return false;
+    }
+    void resendEvent(uint64_t id,
+                     std::reference_wrapper<EventProvider> provider)
+    {
+        auto it = events.find(id);
+        if (it == events.end() || expired(id))
+        {
             return;
         }
+        const auto& event = it->second;
+        indexEvent(id);
         taskQueue.addTask(std::bind_front(&EventQueue::sendEventHandler, this,
                                           id, provider, event),
                           true); // put the task in front
@@ -233,30 +418,79 @@ struct EventQueue
         auto uniqueEventId = epocNow();
         addEvent(event, uniqueEventId);
     }
+    // Queue the event and drop an identical one that is still waiting, so the
+    // newest copy is ordered after anything queued in between. Used for
+    // events that only tell the peer to fetch the current state, like
+    // FileModified.
+    void replaceEvent(const std::string& event)
+    {
+        if (auto it = waiting.find(event); it != waiting.end())
+        {
+            removeEvent(it->second);
+        }
+        addEvent(event);
+    }
     void addEvent(const std::string& event, uint64_t id)
     {
+        unindexEvent(id);
         events[id] = event;
+        eventLog.append(id, event);
+        queueEvent(id, event);
+    }
+    void queueEvent(uint64_t id, const std::string& event)
+    {
+        indexEvent(id);
         auto eventId = getEventId(event);
         auto it = eventProviders.find(eventId);
         if (it == eventProviders.end())
         {
             it = eventProviders.find("default");
         }
+        if (pipelineWindow > 0 && it->first == "default")
+        {
+            pipelined.push_back(id);
+            scheduleBatch();
+            return;
+        }
         std::reference_wrapper<EventProvider> provider(it->second);
 
         taskQueue.addTask(std::bind_front(&EventQueue::sendEventHandler, this,
                                           id, provider, event));
     }
-    bool eventExists(const std::string& event)
+    // True while an identical event is queued and not yet sent. An event
+    // already on the wire does not count, since the peer may have acted on
+    // it before the change that raised the new one.
+    bool eventExists(const std::string& event) const
+    {
+        return waiting.contains(event);
+    }
+    // The index keys are views into the strings held by events, so an event
+    // is unindexed before its string is replaced or erased.
+    void indexEvent(uint64_t id)
     {
-        for (auto& [id, e] : events)
+        auto it = events.find(id);
+        if (it != events.end())
         {
-            if (e == event)
+            unindexEvent(id);
+            waiting.emplace(it->second, id);
+        }
+    }
+    void unindexEvent(uint64_t id)
+    {
+        auto it = events.find(id);
+        if (it == events.end())
+        {
+            return;
+        }
+        auto [first, last] = waiting.equal_range(it->second);
+        for (; first != last; ++first)
+        {
+            if (first->second == id)
             {
-                return true;
+                waiting.erase(first);
+                return;
             }
         }
-        return false;
     }
     net::awaitable<boost::system::error_code> executeConsumer(
         std::reference_wrapper<EventConsumer> consumer, Streamer streamer,
@@ -273,7 +507,7 @@ struct EventQueue
         }
     }
 
-    inline net::awaitable<boost::system::error_code> parseAndHandle(
+    net::awaitable<boost::system::error_code> handleEvent(
         std::string_view header, Streamer streamer)
     {
         auto consumerId = getEventId(header);
@@ -287,10 +521,54 @@ struct EventQueue
         if (ec)
         {
             LOG_ERROR("Failed to handle event: {}", ec.message());
+        }
+        co_return ec;
+    }
+    inline net::awaitable<boost::system::error_code> parseAndHandle(
+        std::string_view header, Streamer streamer)
+    {
+        auto ec = co_await handleEvent(header, streamer);
+        if (ec)
+        {
             co_return ec;
         }
         co_return co_await sendDone(streamer);
     }
+    // Consume the events announced by a "Batch:<seq>:<count>" header and
+    // acknowledge all of them with one "Ack:<last seq>".
+    net::awaitable<boost::system::error_code> handleBatch(
+        const std::string& header, Streamer streamer)
+    {
+        auto [seqText, countText] = parseEvent(parseEvent(header).second);
+        uint64_t seq = 0;
+        uint64_t count = 0;
+        if (std::from_chars(seqText.data(), seqText.data() + seqText.size(),
+                            seq)
+                    .ec != std::errc{} ||
+            std::from_chars(countText.data(),
+                            countText.data() + countText.size(), count)
+                    .ec != std::errc{} ||
+            count == 0)
+        {
+            LOG_ERROR("Malformed batch header: {}", header);
+            co_return boost::asio::error::connection_reset;
+        }
+        for (uint64_t i = 0; i < count; i++)
+        {
+            auto [ec, data] = co_await readHeader(streamer);
+            if (!ec)
+            {
+                ec = co_await handleEvent(data, streamer);
+            }
+            if (ec)
+            {
+                co_return ec;
+            }
+        }
+        auto [ec, size] = co_await sendHeader(
+            streamer, makeEvent(ACK, std::to_string(seq + count - 1), ""));
+        co_return ec;
+    }
     inline net::awaitable<boost::system::error_code> next(Streamer streamer)
     {
         auto [ec, data] = co_await readHeader(streamer);
@@ -298,6 +576,10 @@ struct EventQueue
         {
             co_return ec;
         }
+        if (getEventId(data) == BATCH)
+        {
+            co_return co_await handleBatch(data, streamer);
+        }
         co_return co_await parseAndHandle(data, streamer);
     }
     net::awaitable<void> operator()(
@@ -323,11 +605,18 @@ struct EventQueue
     std::map<std::string, EventProvider> eventProviders;
     std::map<std::string, EventConsumer> eventConsumers;
     std::map<uint64_t, std::string> events;
+    // Events not yet sent, by content, for eventExists and replaceEvent.
+    std::unordered_multimap<std::string_view, uint64_t> waiting;
     TaskQueue taskQueue;
     TcpServer<TcpStreamType, EventQueue> tcpServer;
     DefaultEventProvider defaultProvider;
     DefaultEventConsumer defaultConsumer;
-    JsonSerializer serializer;
+    EventLog eventLog;
     uint64_t lastBarrierTime{0};
+    std::size_t pipelineWindow{0};
+    std::deque<uint64_t> pipelined;
+    uint64_t nextSeq{1};
+    bool batchActive{false};
+    bool legacyPeer{false};
 };
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #pragma once
+#include "name_space.hpp"
+
 #include <unistd.h>
 
 namespace NSNAME
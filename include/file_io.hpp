@@ -1,97 +1,360 @@
 #pragma once
 
 #include "beastdefs.hpp"
+#include "file_descriptor.hpp"
 #include "logger.hpp"
+#include "make_awaitable.hpp"
+#include "worker.hpp"
 
 #include <fcntl.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 
 #include <boost/asio/posix/stream_descriptor.hpp>
 
-#include <iostream>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <vector>
 namespace NSNAME
 {
+namespace detail
+{
+// Positioned reads and writes of a regular file, one at a time, that do not
+// block the io thread. epoll cannot wait on regular files, so a
+// stream_descriptor read or write on one just runs synchronously on the io
+// thread and stalls every other connection for as long as the disk takes.
+// Operations run as pread/pwrite on getFileWorkerPool() instead, and the io
+// thread waits on an eventfd, the same way DnsCache waits for getaddrinfo.
+class FileChannel
+{
+  public:
+    static constexpr std::size_t bufferSize = 64 * 1024;
+
+    FileChannel(net::any_io_executor executor, int fd) :
+        job(std::make_shared<Job>(fd)), done(executor, ::dup(job->done.get()))
+    {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    FileChannel(const FileChannel&) = delete;
+    FileChannel& operator=(const FileChannel&) = delete;
+
+    // Buffer index (0 or 1) of bufferSize bytes, page aligned.
+    char* buffer(int index) const
+    {
+        return job->memory.get() + index * bufferSize;
+    }
+    // An operation was started and wait() has not collected its result.
+    bool busy() const
+    {
+        return running;
+    }
+    // No operation is running on the worker, whether or not its result was
+    // collected.
+    bool idle() const
+    {
+        return !running || job->finished.load(std::memory_order_acquire);
+    }
+
+    // Start reading up to size bytes into, or writing size bytes from,
+    // buffer index at offset. At most one operation runs at a time.
+    void start(bool write, int index, std::uint64_t offset, std::size_t size)
+    {
+        running = true;
+        job->finished.store(false, std::memory_order_relaxed);
+        getFileWorkerPool().addTask([job = job, write, index, offset, size] {
+            job->run(write, index, offset, size);
+        });
+    }
+
+    // Wait for the operation started last; a read returns 0 bytes at the
+    // end of the file, a write returns once all bytes are written.
+    AwaitableResult<std::size_t> wait()
+    {
+        boost::system::error_code ec;
+        while (running && !job->finished.load(std::memory_order_acquire))
+        {
+            co_await done.async_wait(
+                net::posix::stream_descriptor::wait_read,
+                net::redirect_error(net::use_awaitable, ec));
+            std::uint64_t count = 0;
+            [[maybe_unused]] auto n =
+                ::read(done.native_handle(), &count, sizeof(count));
+        }
+        running = false;
+        co_return std::make_pair(job->ec, job->bytes);
+    }
+
+    // Write size bytes of buffer index at offset before returning. Only for
+    // destructors that cannot wait; does not run concurrently with start().
+    void writeNow(int index, std::uint64_t offset, std::size_t size)
+    {
+        job->run(true, index, offset, size);
+    }
+
+  private:
+    struct Free
+    {
+        void operator()(char* memory) const
+        {
+            std::free(memory);
+        }
+    };
+
+    // What the worker thread touches; no Asio objects, so whichever thread
+    // drops it last may destroy it.
+    struct Job
+    {
+        explicit Job(int fd) :
+            file(fd), done(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+            memory(static_cast<char*>(
+                std::aligned_alloc(4096, 2 * bufferSize)))
+        {}
+
+        void run(bool write, int index, std::uint64_t offset,
+                 std::size_t size)
+        {
+            char* data = memory.get() + index * bufferSize;
+            std::size_t total = 0;
+            int error = 0;
+            while (total < size)
+            {
+                auto n = write
+                             ? ::pwrite(file.get(), data + total, size - total,
+                                        static_cast<off_t>(offset + total))
+                             : ::pread(file.get(), data, size,
+                                       static_cast<off_t>(offset));
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n < 0)
+                {
+                    error = errno;
+                    break;
+                }
+                total += static_cast<std::size_t>(n);
+                if (!write)
+                {
+                    break; // a short read is the end of the file
+                }
+            }
+            finish(error ? boost::system::error_code(
+                               error, boost::system::system_category())
+                         : boost::system::error_code{},
+                   total);
+            std::uint64_t one = 1;
+            [[maybe_unused]] auto n = ::write(done.get(), &one, sizeof(one));
+        }
+
+        void finish(boost::system::error_code result, std::size_t transferred)
+        {
+            ec = result;
+            bytes = transferred;
+            finished.store(true, std::memory_order_release);
+        }
+
+        FileDescriptor file;
+        FileDescriptor done; // eventfd the worker signals
+        std::unique_ptr<char, Free> memory;
+        std::atomic<bool> finished{true};
+        boost::system::error_code ec;
+        std::size_t bytes{0};
+    };
+
+    std::shared_ptr<Job> job;
+    net::posix::stream_descriptor done;
+    bool running{false};
+};
+
+inline std::uint64_t currentOffset(int fd)
+{
+    auto offset = ::lseek(fd, 0, SEEK_CUR);
+    return offset < 0 ? 0 : static_cast<std::uint64_t>(offset);
+}
+} // namespace detail
+
+// Writes a regular file from its current offset without blocking the io
+// thread. write() copies the data into one of two buffers and returns once
+// it is queued, so the caller produces the next buffer while the previous
+// one is written; call flush() to wait for everything and see the result.
+// Takes ownership of fd.
 class AsyncFileWriter
 {
   public:
     AsyncFileWriter(net::any_io_executor io_context, int fd) :
-        stream_(io_context, fd), fd_(fd)
+        offset_(detail::currentOffset(fd)),
+        channel_(std::make_shared<detail::FileChannel>(io_context, fd))
     {}
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
     ~AsyncFileWriter()
     {
-        // Close the file descriptor when the object is destroyed
-        if (fd_ != -1)
+        // Not flushed: write the rest here rather than lose it, once the
+        // previous write is done. A write still running finishes on its own.
+        if (filled_ > 0 && channel_->idle())
+        {
+            channel_->writeNow(current_, offset_, filled_);
+        }
+        else if (filled_ > 0)
         {
-            ::close(fd_);
+            LOG_ERROR("AsyncFileWriter destroyed unflushed, {} bytes lost",
+                      filled_);
         }
     }
 
     net::awaitable<boost::system::error_code> write(net::const_buffer data)
     {
-        // Start an asynchronous write operation
-        co_return co_await async_write_some(data);
+        while (data.size() > 0)
+        {
+            auto bytes = std::min(data.size(),
+                                  detail::FileChannel::bufferSize - filled_);
+            std::memcpy(channel_->buffer(current_) + filled_, data.data(),
+                        bytes);
+            filled_ += bytes;
+            data += bytes;
+            if (filled_ == detail::FileChannel::bufferSize)
+            {
+                if (auto ec = co_await submit())
+                {
+                    co_return ec;
+                }
+            }
+        }
+        co_return boost::system::error_code{};
+    }
+
+    // Wait until everything written so far is in the file.
+    net::awaitable<boost::system::error_code> flush()
+    {
+        if (filled_ > 0)
+        {
+            if (auto ec = co_await submit())
+            {
+                co_return ec;
+            }
+        }
+        auto [ec, bytes] = co_await channel_->wait();
+        if (ec)
+        {
+            LOG_ERROR("Error writing to file: {}", ec.message());
+        }
+        co_return ec;
     }
 
   private:
-    net::awaitable<boost::system::error_code> async_write_some(
-        net::const_buffer data)
+    // Wait for the previous buffer, then start writing the current one.
+    net::awaitable<boost::system::error_code> submit()
     {
-        // Write data asynchronously
-        boost::system::error_code ec;
-        co_await stream_.async_write_some(
-            data, net::redirect_error(net::use_awaitable, ec));
+        auto [ec, bytes] = co_await channel_->wait();
         if (ec)
         {
             LOG_ERROR("Error writing to file: {}", ec.message());
             co_return ec;
         }
+        channel_->start(true, current_, offset_, filled_);
+        offset_ += filled_;
+        current_ = 1 - current_;
+        filled_ = 0;
         co_return boost::system::error_code{};
     }
 
-    net::posix::stream_descriptor stream_;
-    int fd_{-1};
+    std::uint64_t offset_;
+    std::shared_ptr<detail::FileChannel> channel_;
+    int current_{0};
+    std::size_t filled_{0};
 };
+
+// Reads a regular file from its current offset without blocking the io
+// thread. Reads go to the file in bufferSize blocks, and the next block is
+// read ahead while the caller consumes the current one. Returns eof at the
+// end of the file. Takes ownership of fd.
 class AsyncFileReader
 {
   public:
     AsyncFileReader(net::any_io_executor io_context, int fd) :
-        stream_(io_context, fd), fd_(fd)
+        offset_(detail::currentOffset(fd)),
+        channel_(std::make_shared<detail::FileChannel>(io_context, fd))
     {}
-    ~AsyncFileReader()
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    net::awaitable<std::pair<boost::system::error_code, std::size_t>> read(
+        net::mutable_buffer buffer)
     {
-        // Close the file descriptor when the object is destroyed
-        if (fd_ != -1)
+        auto [ec, block] = co_await readBlock(buffer.size());
+        if (ec)
         {
-            ::close(fd_);
+            co_return std::make_pair(ec, 0);
         }
+        std::memcpy(buffer.data(), block.data(), block.size());
+        co_return std::make_pair(ec, block.size());
     }
 
-    net::awaitable<std::pair<boost::system::error_code, std::size_t>> read(
-        net::mutable_buffer buffer)
+    // The next at most maxSize bytes of the file, as a view into the
+    // reader's buffer that stays valid until the next call. Lets the caller
+    // write file data out without copying it first.
+    AwaitableResult<net::const_buffer> readBlock(
+        std::size_t maxSize = detail::FileChannel::bufferSize)
     {
-        // Start an asynchronous read operation
-        co_return co_await async_read_some(buffer);
+        if (readyPos_ == readySize_)
+        {
+            if (!channel_->busy())
+            {
+                fetch();
+            }
+            auto [ec, bytes] = co_await channel_->wait();
+            if (ec)
+            {
+                LOG_ERROR("Error reading from file: {}", ec.message());
+                co_return std::make_pair(ec, net::const_buffer{});
+            }
+            if (bytes == 0)
+            {
+                co_return std::make_pair(
+                    boost::system::error_code{net::error::eof},
+                    net::const_buffer{});
+            }
+            ready_ = 1 - ready_;
+            readyPos_ = 0;
+            readySize_ = bytes;
+            offset_ += bytes;
+            fetch();
+        }
+        auto bytes = std::min(maxSize, readySize_ - readyPos_);
+        net::const_buffer block(channel_->buffer(ready_) + readyPos_, bytes);
+        readyPos_ += bytes;
+        co_return std::make_pair(boost::system::error_code{}, block);
     }
 
-  private:
-    net::awaitable<std::pair<boost::system::error_code, std::size_t>>
-        async_read_some(net::mutable_buffer buffer)
+    // Continue reading at offset. A read-ahead still running is waited for
+    // and dropped.
+    net::awaitable<void> seek(std::uint64_t offset)
     {
-        // Read data asynchronously
-        boost::system::error_code ec;
-        std::size_t bytes_transferred = co_await stream_.async_read_some(
-            buffer, net::redirect_error(net::use_awaitable, ec));
-        if (ec)
+        if (channel_->busy())
         {
-            LOG_ERROR("Error reading from file: {}", ec.message());
-            co_return std::make_pair(ec, 0);
+            co_await channel_->wait();
         }
-        co_return std::make_pair(boost::system::error_code{},
-                                 bytes_transferred);
+        offset_ = offset;
+        readyPos_ = 0;
+        readySize_ = 0;
+    }
+
+  private:
+    // Read the block at offset_ into the buffer not being consumed.
+    void fetch()
+    {
+        channel_->start(false, 1 - ready_, offset_,
+                        detail::FileChannel::bufferSize);
     }
 
-    net::posix::stream_descriptor stream_;
-    int fd_{-1};
+    std::uint64_t offset_;
+    std::shared_ptr<detail::FileChannel> channel_;
+    int ready_{1}; // buffer being consumed; the other one is read into
+    std::size_t readyPos_{0};
+    std::size_t readySize_{0};
 };
 } // namespace NSNAME
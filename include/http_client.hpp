@@ -19,24 +19,13 @@ class HttpClient
         boost::system::error_code ec;
         if constexpr (std::is_same_v<Stream, beast::tcp_stream>)
         {
-            net::ip::tcp::resolver resolver_(ioc);
-            try
-            {
-                auto [ec, results] =
-                    co_await awaitable_resolve(resolver_, host, port);
-                if (ec)
-                    co_return ec;
-                setTimeout(5s);
-                co_await getLowestLayer().async_connect(
-                    results, net::redirect_error(net::use_awaitable, ec));
-                if (ec)
-                    co_return ec;
-            }
-            catch (const std::exception& e)
-            {
-                co_return boost::system::errc::make_error_code(
-                    boost::system::errc::host_unreachable);
-            }
+            auto [ec, endpoints] = co_await getDnsCache().resolve(host, port);
+            if (ec)
+                co_return ec;
+            ec = co_await connectEndpoints(getLowestLayer().socket(),
+                                           endpoints, 5s);
+            if (ec)
+                co_return ec;
         }
         else if constexpr (std::is_same_v<Stream, unix_domain::socket>)
         {
@@ -45,15 +34,26 @@ class HttpClient
                 co_return ec;
         }
         // Set the SNI hostname so the server (e.g. bmcweb) can select the
-        // correct certificate during the TLS handshake.
+        // correct certificate during the TLS handshake, and offer the session
+        // of the last connection to the same peer.
         if constexpr (std::is_same_v<Stream, beast::tcp_stream>)
         {
             SSL_set_tlsext_host_name(stream_.native_handle(), host.c_str());
+            getTlsSessionCache().prepare(stream_.native_handle(),
+                                         host + ":" + port);
+        }
+        else
+        {
+            getTlsSessionCache().prepare(stream_.native_handle(), host);
         }
         setTimeout(5s);
         co_await stream_.async_handshake(
             ssl::stream_base::client,
             net::redirect_error(net::use_awaitable, ec));
+        if (!ec)
+        {
+            getTlsStats().client.record(stream_.native_handle());
+        }
         co_return ec;
     }
 
@@ -97,6 +97,32 @@ class HttpClient
         co_return std::make_pair(ec, status);
     }
 
+    // Incremental reads through a caller owned parser, for bodies that are
+    // consumed as they arrive. read_some() returns need_buffer once a
+    // buffer_body's buffer is full.
+    template <typename Body>
+    net::awaitable<boost::system::error_code>
+        read_header(http::response_parser<Body>& parser)
+    {
+        boost::system::error_code ec;
+        setTimeout(30s);
+        co_await http::async_read_header(
+            stream_, beastBuffer_, parser,
+            net::redirect_error(net::use_awaitable, ec));
+        co_return ec;
+    }
+    template <typename Body>
+    net::awaitable<boost::system::error_code>
+        read_some(http::response_parser<Body>& parser)
+    {
+        boost::system::error_code ec;
+        setTimeout(30s);
+        co_await http::async_read_some(
+            stream_, beastBuffer_, parser,
+            net::redirect_error(net::use_awaitable, ec));
+        co_return ec;
+    }
+
     // Read raw bytes from the stream until `delim` is found.
     // Uses net::streambuf so extraction is a plain istream read — no iterator
     // arithmetic, no segment-boundary issues.
@@ -19,7 +19,6 @@ inline Response make_file_not_found_error(const std::string& path, int version)
 {
     Response res{http::status::not_found, version};
     res.set(http::field::content_type, "text/plain");
-    res.keep_alive(false);
     res.body() = std::format("File Not Found: {}", path);
     res.prepare_payload();
     return res;
@@ -29,7 +28,6 @@ inline Response make_internal_server_error(const std::string& message,
 {
     Response res{http::status::internal_server_error, version};
     res.set(http::field::content_type, "text/plain");
-    res.keep_alive(false);
     res.body() = std::format("Internal Server Error: {}", message);
     res.prepare_payload();
     return res;
@@ -38,7 +36,6 @@ inline Response make_bad_request_error(const std::string& message, int version)
 {
     Response res{http::status::bad_request, version};
     res.set(http::field::content_type, "text/plain");
-    res.keep_alive(false);
     res.body() = std::format("Bad Request: {}", message);
     res.prepare_payload();
     return res;
@@ -47,7 +44,6 @@ inline Response make_unauthorized_error(const std::string& message, int version)
 {
     Response res{http::status::unauthorized, version};
     res.set(http::field::content_type, "text/plain");
-    res.keep_alive(false);
     res.body() = std::format("Unauthorized: {}", message);
     res.prepare_payload();
     return res;
@@ -56,7 +52,6 @@ inline Response make_forbidden_error(const std::string& message, int version)
 {
     Response res{http::status::forbidden, version};
     res.set(http::field::content_type, "text/plain");
-    res.keep_alive(false);
     res.body() = std::format("Forbidden: {}", message);
     res.prepare_payload();
     return res;
@@ -74,7 +69,6 @@ inline Response make_success_response(
 {
     Response res{st, version};
     res.set(http::field::content_type, content_type);
-    res.keep_alive(false);
     res.body() = std::string(std::string_view(data));
     res.prepare_payload();
     return res;
@@ -1,14 +1,17 @@
 #pragma once
 
-#include "flat_map.hpp"
 #include "http_errors.hpp"
 #include "http_target_parser.hpp"
 #include "request_mapper.hpp"
+#include "route_trie.hpp"
 #include "socket_streams.hpp"
+#include "trace.hpp"
 
 #include <concepts>
 #include <functional>
+#include <optional>
 #include <unordered_map>
+#include <variant>
 namespace NSNAME
 {
 
@@ -20,6 +23,45 @@ struct SseWriter
     std::function<boost::asio::awaitable<bool>(std::string /*data*/)> write;
 };
 
+// Response whose body is produced while it is being sent. next() is called
+// again only after the previous piece has been written to the socket, so a
+// slow client holds the producer back and at most one piece is held in
+// memory. An empty optional ends the body. Unless the header carries a
+// Content-Length (which the pieces must then add up to) the body is sent with
+// chunked transfer encoding.
+struct StreamedResponse
+{
+    http::response<http::empty_body> header;
+    std::function<net::awaitable<std::optional<std::string>>()> next;
+    // Used instead of next when set, by producers that own the storage of
+    // their pieces: the buffer must stay valid until nextBuffer is called
+    // again, and is written out without being copied first.
+    std::function<net::awaitable<std::optional<net::const_buffer>>()>
+        nextBuffer;
+};
+using FileResponse = http::response<http::file_body>;
+using StreamResponse = std::variant<Response, FileResponse, StreamedResponse>;
+
+// Open path as a FileResponse. Returns nullopt when the file cannot be read.
+inline std::optional<FileResponse>
+    make_file_response(const std::string& path, std::string_view contentType,
+                       int version)
+{
+    beast::error_code ec;
+    http::file_body::value_type body;
+    body.open(path.c_str(), beast::file_mode::scan, ec);
+    if (ec)
+    {
+        LOG_DEBUG("Cannot open {}: {}", path, ec.message());
+        return std::nullopt;
+    }
+    FileResponse res{std::piecewise_construct, std::make_tuple(std::move(body)),
+                     std::make_tuple(http::status::ok, version)};
+    res.set(http::field::content_type, contentType);
+    res.prepare_payload();
+    return res;
+}
+
 template <typename T>
 concept AwaitableResponseHandler =
     requires(T t, Request& req, const http_function& params) {
@@ -43,6 +85,14 @@ auto make_awitable_handler(HandlerFunc&& h)
                -> net::awaitable<Response> { co_return h(req, params); };
 }
 
+// Concept for handlers whose response may be a file or a streamed body:
+// (Request&, http_function&) -> awaitable<StreamResponse>
+template <typename T>
+concept AwaitableStreamHandler =
+    requires(T t, Request& req, const http_function& params) {
+        { t(req, params) } -> std::same_as<net::awaitable<StreamResponse>>;
+    };
+
 // Concept for SSE streaming handlers: (Request&, http_function&, SseWriter) -> awaitable<void>
 template <typename T>
 concept SseHandler =
@@ -58,7 +108,7 @@ struct HttpRouter
             Request& req, const http_function& vw) = 0;
         virtual ~handler_base() {}
     };
-    using HANDLER_MAP = flat_map<request_mapper, std::unique_ptr<handler_base>>;
+    using HANDLER_MAP = RouteTrie<std::unique_ptr<handler_base>>;
     template <typename HandlerFunc>
     struct handler : handler_base
     {
@@ -82,7 +132,7 @@ struct HttpRouter
     void add_handler(const request_mapper& mapper, FUNC&& h)
     {
         auto& handlers = handler_for_verb(mapper.method);
-        handlers[mapper] = std::make_unique<handler<FUNC>>(std::move(h));
+        handlers[mapper.path] = std::make_unique<handler<FUNC>>(std::move(h));
     }
     template <AwaitableResponseHandler FUNC>
     void add_get_handler(std::string_view path, FUNC&& h)
@@ -144,6 +194,35 @@ struct HttpRouter
         return &it->second;
     }
 
+    // Register a GET handler that may answer with a FileResponse or a
+    // StreamedResponse, so large bodies are never materialized in memory.
+    // Streaming routes are matched before the regular GET routes.
+    template <AwaitableStreamHandler FUNC>
+    void add_streaming_get_handler(std::string_view path, FUNC&& h)
+    {
+        stream_handlers[path] = std::forward<FUNC>(h);
+    }
+
+    using StreamHandlerFn = std::function<net::awaitable<StreamResponse>(
+        Request&, const http_function&)>;
+
+    // Match httpfunc against the streaming routes, adding the captured path
+    // parameters to it on success.
+    StreamHandlerFn* findStreamHandler(http_function& httpfunc)
+    {
+        RouteParams captures;
+        auto* h = stream_handlers.match(httpfunc.name(), captures);
+        if (h == nullptr || !*h)
+        {
+            return nullptr;
+        }
+        for (const auto& [name, value] : captures)
+        {
+            httpfunc.params().emplace_back(name, std::string(value));
+        }
+        return h;
+    }
+
     // Set a fallback handler that will be called when no route matches
     template <AwaitableResponseHandler FUNC>
     void set_fallback_handler(FUNC&& h)
@@ -151,6 +230,32 @@ struct HttpRouter
         fallback_handler = std::make_unique<handler<FUNC>>(std::move(h));
     }
 
+    // Streaming counterpart of the fallback handler, for any method. Takes
+    // precedence over set_fallback_handler.
+    template <AwaitableStreamHandler FUNC>
+    void set_streaming_fallback_handler(FUNC&& h)
+    {
+        stream_fallback_handler = std::forward<FUNC>(h);
+    }
+
+    // The streaming fallback, if set and no regular route of the request's
+    // method matches httpfunc.
+    StreamHandlerFn* findStreamFallback(http::verb method,
+                                        const http_function& httpfunc)
+    {
+        if (!stream_fallback_handler)
+        {
+            return nullptr;
+        }
+        RouteParams captures;
+        if (auto* h = handler_for_verb(method).match(httpfunc.name(), captures);
+            h && *h)
+        {
+            return nullptr;
+        }
+        return &stream_fallback_handler;
+    }
+
     HANDLER_MAP& handler_for_verb(http::verb v)
     {
         switch (v)
@@ -158,6 +263,7 @@ struct HttpRouter
             case http::verb::get:
                 return get_handlers;
             case http::verb::put:
+                return put_handlers;
             case http::verb::post:
                 return post_handlers;
             case http::verb::delete_:
@@ -171,31 +277,37 @@ struct HttpRouter
     boost::asio::awaitable<Response> process_request(auto& reqVariant,
                                                      tcp::endpoint&& ep)
     {
+        TraceSpan span(TraceEvent::Route, traceId(&reqVariant));
         auto httpfunc = parse_function(reqVariant.target());
         httpfunc.setEndpoint(std::move(ep));
         auto& handlers = handler_for_verb(reqVariant.method());
-        if (auto iter = handlers.find({httpfunc.name(), reqVariant.method()});
-            iter != std::end(handlers))
+        RouteParams captures;
+        Response res;
+        if (auto* h = handlers.match(httpfunc.name(), captures); h && *h)
         {
-            extract_params_from_path(httpfunc, iter->first.path,
-                                     httpfunc.name());
-            co_return co_await iter->second->handle(reqVariant, httpfunc);
+            for (const auto& [name, value] : captures)
+            {
+                httpfunc.params().emplace_back(name, std::string(value));
+            }
+            res = co_await (*h)->handle(reqVariant, httpfunc);
         }
-
         // If no route matched, try fallback handler
-        if (fallback_handler)
+        else if (fallback_handler)
         {
-            co_return co_await fallback_handler->handle(reqVariant, httpfunc);
+            res = co_await fallback_handler->handle(reqVariant, httpfunc);
         }
-
-        co_return make_error_response(reqVariant, httpfunc.name());
+        else
+        {
+            res = make_error_response(reqVariant, httpfunc.name());
+        }
+        span.arg1 = res.result_int();
+        co_return res;
     }
 
     Response make_error_response(Request& req, const std::string& message)
     {
         Response res{http::status::not_found, 11};
         res.set(http::field::content_type, "text/plain");
-        res.keep_alive(false);
         res.body() = std::format("Not Found {}", message);
         res.prepare_payload();
         return res;
@@ -207,10 +319,13 @@ struct HttpRouter
     }
 
     HANDLER_MAP get_handlers;
+    HANDLER_MAP put_handlers;
     HANDLER_MAP post_handlers;
     HANDLER_MAP delete_handlers;
     HANDLER_MAP empty_handlers;
     std::unordered_map<std::string, SseHandlerFn> sse_handlers;
+    RouteTrie<StreamHandlerFn> stream_handlers;
+    StreamHandlerFn stream_fallback_handler;
     std::optional<std::reference_wrapper<net::io_context>> ioc;
 };
 
@@ -225,6 +340,20 @@ class HttpServer
         start_accept();
     }
 
+    // How long a persistent connection may sit idle between requests before
+    // the server closes it.
+    void setIdleTimeout(std::chrono::seconds timeout)
+    {
+        idleTimeout = timeout;
+    }
+
+    // Number of requests served on one connection before the server answers
+    // with "Connection: close".
+    void setMaxRequestsPerConnection(std::size_t count)
+    {
+        maxRequestsPerConnection = std::max<std::size_t>(count, 1);
+    }
+
   private:
     void start_accept()
     {
@@ -251,66 +380,302 @@ class HttpServer
     boost::asio::awaitable<void> handle_client(
         std::shared_ptr<boost::asio::ssl::stream<Socket>> socket)
     {
+        TraceSpan connectionSpan(TraceEvent::Connection, traceId(socket.get()));
         // Perform SSL handshake
-        co_await socket->async_handshake(boost::asio::ssl::stream_base::server,
-                                         boost::asio::use_awaitable);
+        {
+            TraceSpan handshakeSpan(TraceEvent::Handshake,
+                                    traceId(socket.get()));
+            handshakeSpan.arg1 = 1; // cleared unless the handshake throws
+            co_await socket->async_handshake(
+                boost::asio::ssl::stream_base::server,
+                boost::asio::use_awaitable);
+            handshakeSpan.arg1 = 0;
+        }
+        getTlsStats().server.record(socket->native_handle());
 
+        // The buffer outlives a single request so that pipelined requests
+        // already read off the wire are parsed on the next iteration.
         beast::flat_buffer buffer;
-        Request req;
-
-        // Read the HTTP request
+        net::steady_timer idleTimer(context);
+        std::size_t served = 0;
         boost::system::error_code ec;
-        co_await http::async_read(
-            *socket, buffer, req,
-            boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-        if (ec)
+        while (true)
         {
-            std::cerr << "Error reading request: " << ec.message() << std::endl;
-            co_return;
-        }
+            Request req;
+
+            // Read the HTTP request, giving up when the connection stays idle
+            // for longer than idleTimeout.
+            armIdleTimer(idleTimer, socket);
+            co_await http::async_read(
+                *socket, buffer, req,
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            idleTimer.cancel();
+            if (ec)
+            {
+                if (ec == http::error::end_of_stream)
+                {
+                    // Client closed its side cleanly between requests
+                    break;
+                }
+                if (ec == net::error::operation_aborted)
+                {
+                    LOG_DEBUG("Closing idle connection after {} requests",
+                              served);
+                    break;
+                }
+                if (ec != net::error::eof && ec != ssl::error::stream_truncated)
+                {
+                    LOG_ERROR("Error reading request: {}", ec.message());
+                }
+                co_return;
+            }
+            ++served;
+            LOG_DEBUG("Received request: {} {}", req.method_string(),
+                      req.target());
+            TraceSpan requestSpan(TraceEvent::Request, traceId(&req),
+                                  static_cast<std::uint64_t>(req.method()));
+
+            // Check if this is an SSE subscription request. SSE streams own
+            // the connection until the client goes away.
+            auto httpfunc = parse_function(req.target());
+            if (req.method() == http::verb::get)
+            {
+                if (auto* sseFn = router_.findSseHandler(httpfunc.name()))
+                {
+                    co_await handle_sse_client(socket, req, httpfunc, *sseFn);
+                    co_return;
+                }
+            }
 
-        std::cout << "Received request: " << req.body().data() << std::endl;
+            HttpRouter::StreamHandlerFn* streamFn = nullptr;
+            if (req.method() == http::verb::get)
+            {
+                streamFn = router_.findStreamHandler(httpfunc);
+            }
+            if (streamFn == nullptr)
+            {
+                streamFn = router_.findStreamFallback(req.method(), httpfunc);
+            }
 
-        // Check if this is an SSE subscription request
-        auto httpfunc = parse_function(req.target());
-        if (req.method() == http::verb::get)
-        {
-            if (auto* sseFn = router_.findSseHandler(httpfunc.name()))
+            StreamResponse res;
+            try
             {
-                co_await handle_sse_client(socket, req, httpfunc, *sseFn);
+                if (streamFn)
+                {
+                    httpfunc.setEndpoint(acceptor_.getRemoteEndpoint(*socket));
+                    res = co_await (*streamFn)(req, httpfunc);
+                }
+                else
+                {
+                    res = co_await router_.process_request(
+                        req, acceptor_.getRemoteEndpoint(*socket));
+                }
+            }
+            catch (const std::exception& e)
+            {
+                res = make_internal_server_error("Internal Server Error",
+                                                 req.version());
+            }
+
+            // Keep the connection only when the client asked for it, the
+            // handler did not force a close and the per-connection request
+            // budget is not exhausted.
+            bool keepAlive = visitMessage(res, [&](auto& message) {
+                bool keep = req.keep_alive() &&
+                            !handlerRequestedClose(message) &&
+                            served < maxRequestsPerConnection;
+                message.keep_alive(keep);
+                return keep;
+            });
+
+            // Write the response
+            {
+                TraceSpan writeSpan(TraceEvent::Write, traceId(&req));
+                ec = co_await writeResponse(*socket, res);
+                writeSpan.arg1 = ec ? 1 : 0;
+            }
+            if (ec)
+            {
+                LOG_ERROR("Error writing response: {}", ec.message());
                 co_return;
             }
+            // A streamed body without a length ends by closing the
+            // connection, so writing it may have cleared keep-alive.
+            if (!keepAlive ||
+                !visitMessage(res, [](auto& m) { return m.keep_alive(); }))
+            {
+                break;
+            }
         }
+        // Close the socket
+        co_await shutdown(socket);
+    }
 
-        Response res;
-        try
+    // The response helpers leave the Connection header alone, so it is only
+    // present when a handler opts out with res.keep_alive(false).
+    static bool handlerRequestedClose(const auto& res)
+    {
+        return res.find(http::field::connection) != res.end() &&
+               !res.keep_alive();
+    }
+
+    // Call f with the message carrying the response's status and fields.
+    template <typename Func>
+    static auto visitMessage(StreamResponse& res, Func&& f)
+    {
+        return std::visit(
+            [&](auto& r) {
+                if constexpr (std::same_as<std::decay_t<decltype(r)>,
+                                           StreamedResponse>)
+                {
+                    return f(r.header);
+                }
+                else
+                {
+                    return f(r);
+                }
+            },
+            res);
+    }
+
+    template <typename Stream>
+    boost::asio::awaitable<boost::system::error_code>
+        writeResponse(Stream& socket, StreamResponse& res)
+    {
+        boost::system::error_code ec;
+        if (auto* r = std::get_if<Response>(&res))
+        {
+            co_await http::async_write(
+                socket, *r,
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        }
+        else if (auto* f = std::get_if<FileResponse>(&res))
+        {
+            // TLS encrypts in user space, so the file is read in bounded
+            // pieces by file_body rather than handed to sendfile().
+            co_await http::async_write(
+                socket, *f,
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        }
+        else
+        {
+            ec = co_await writeStreamed(socket, std::get<StreamedResponse>(res));
+        }
+        co_return ec;
+    }
+
+    // Send the header, then pull pieces from the producer one at a time,
+    // writing each before asking for the next.
+    template <typename Stream>
+    boost::asio::awaitable<boost::system::error_code>
+        writeStreamed(Stream& socket, StreamedResponse& res)
+    {
+        auto& header = res.header;
+        bool chunked = !header.has_content_length() && header.version() >= 11;
+        if (!header.has_content_length() && !chunked)
         {
-            res = co_await router_.process_request(
-                req, acceptor_.getRemoteEndpoint(*socket));
+            // HTTP/1.0 has no chunking; the end of the body is the close.
+            header.keep_alive(false);
         }
-        catch (const std::exception& e)
+        if (chunked)
         {
-            res = make_internal_server_error("Internal Server Error",
-                                             req.version());
+            // chunked(false) would drop a Content-Length the header carries
+            header.chunked(true);
         }
-        // Write the response
-        co_await http::async_write(
-            *socket, res,
+
+        boost::system::error_code ec;
+        http::response_serializer<http::empty_body> sr{header};
+        co_await http::async_write_header(
+            socket, sr,
             boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-        if (ec)
+        std::optional<std::string> owned;
+        while (!ec)
         {
-            std::cerr << "Error writing response: " << ec.message()
-                      << std::endl;
-            co_return;
+            std::optional<net::const_buffer> piece;
+            try
+            {
+                if (res.nextBuffer)
+                {
+                    piece = co_await res.nextBuffer();
+                }
+                else if ((owned = co_await res.next()))
+                {
+                    piece = net::buffer(*owned);
+                }
+            }
+            catch (const std::exception& e)
+            {
+                // The status line is already out; all we can do is cut the
+                // body short so the client sees an incomplete message.
+                LOG_ERROR("Streamed body failed: {}", e.what());
+                co_return http::error::partial_message;
+            }
+            if (!piece)
+            {
+                break;
+            }
+            if (piece->size() == 0)
+            {
+                continue; // an empty chunk would terminate the body
+            }
+            if (chunked)
+            {
+                co_await net::async_write(
+                    socket, http::make_chunk(*piece),
+                    boost::asio::redirect_error(boost::asio::use_awaitable,
+                                                ec));
+            }
+            else
+            {
+                co_await net::async_write(
+                    socket, *piece,
+                    boost::asio::redirect_error(boost::asio::use_awaitable,
+                                                ec));
+            }
         }
-        // Close the socket
+        if (!ec && chunked)
+        {
+            co_await net::async_write(
+                socket, http::make_chunk_last(),
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        }
+        co_return ec;
+    }
+
+    template <typename Stream>
+    void armIdleTimer(net::steady_timer& timer, std::shared_ptr<Stream> socket)
+    {
+        timer.expires_after(idleTimeout);
+        timer.async_wait([weak = std::weak_ptr<Stream>(socket)](
+                             const boost::system::error_code& ec) {
+            if (ec)
+            {
+                return;
+            }
+            if (auto sock = weak.lock())
+            {
+                boost::system::error_code cancelEc;
+                beast::get_lowest_layer(*sock).cancel(cancelEc);
+            }
+        });
+    }
+
+    // Send the TLS close_notify.  The peer may never answer it, so the
+    // shutdown is bounded by the idle timeout as well.
+    template <typename Stream>
+    boost::asio::awaitable<void> shutdown(std::shared_ptr<Stream> socket)
+    {
+        net::steady_timer timer(context);
+        armIdleTimer(timer, socket);
+        boost::system::error_code ec;
         co_await socket->async_shutdown(
             boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-        if (ec)
+        timer.cancel();
+        if (ec && ec != net::error::eof && ec != ssl::error::stream_truncated)
         {
-            std::cerr << "Error shutting down SSL: " << ec.message()
-                      << std::endl;
+            LOG_DEBUG("Error shutting down SSL: {}", ec.message());
         }
+        beast::get_lowest_layer(*socket).close(ec);
     }
 
     // Handle a long-lived SSE connection: send headers then delegate to the
@@ -374,5 +739,7 @@ class HttpServer
     boost::asio::io_context& context;
     Accepter& acceptor_;
     HttpRouter& router_;
+    std::chrono::seconds idleTimeout{30s};
+    std::size_t maxRequestsPerConnection{100};
 };
 } // namespace NSNAME
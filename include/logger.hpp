@@ -1,14 +1,19 @@
 #pragma once
 #include "name_space.hpp"
+#ifdef USE_ASYNC_LOGGER
+#include "async_logger.hpp"
+#endif
 
 #include <systemd/sd-journal.h>
 
 #include <array>
 #include <format>
 #include <iostream>
+#include <iterator>
 #include <source_location>
 #include <string>
 #include <string_view>
+#include <utility>
 
 #undef LOG_WARNING
 #undef LOG_ERROR
@@ -78,28 +83,44 @@ class Logger
         currentLogLevel = level;
     }
 
+    // The LOG_* macros check this before formatting their arguments.
+    bool isEnabled(LogLevel level) const noexcept
+    {
+        return level >= currentLogLevel;
+    }
+
     void log(const std::source_location& loc, LogLevel level,
              std::string_view message) const
+    {
+        logFormat(loc, level, "{}", message);
+    }
+
+    // Formats the line, prefix and message alike, into a buffer kept per
+    // thread, so an enabled line allocates nothing once the buffer has grown
+    // to the longest line the thread logs.
+    template <typename... Args>
+    void logFormat(const std::source_location& loc, LogLevel level,
+                   std::format_string<Args...> format, Args&&... args) const
     {
         if (!isEnabled(level))
         {
             return;
         }
+        thread_local std::string line;
+        line.clear();
         std::string_view fullPath = loc.file_name();
         std::string_view filename = fullPath.substr(fullPath.rfind('/') + 1);
-        output << std::format("[{}] {}:{} {}", levelPrefix(level), filename,
-                              loc.line(), message);
+        std::format_to(std::back_inserter(line), "[{}] {}:{} ",
+                       levelPrefix(level), filename, loc.line());
+        std::format_to(std::back_inserter(line), format,
+                       std::forward<Args>(args)...);
+        output << line;
         output.flush(toSystemdLevel(level));
     }
 
   private:
     LogLevel currentLogLevel;
     OutputStream& output;
-
-    bool isEnabled(LogLevel level) const noexcept
-    {
-        return level >= currentLogLevel;
-    }
 };
 
 // Backend: systemd journal via sd_journal_send.
@@ -146,8 +167,22 @@ struct OStreamLogger
 // Select the active backend at compile time.
 // Define USE_LG2_LOGGER (e.g. via -DUSE_LG2_LOGGER) to route logs to the
 // systemd journal.  Omit it (the default) to log to stdout — handy for
-// development and unit tests.
+// development and unit tests.  Define USE_ASYNC_LOGGER as well to have
+// either written by a background thread (see async_logger.hpp).
+#if defined(USE_ASYNC_LOGGER)
+inline Logger<AsyncRingLogger<>>& getLogger()
+{
 #ifdef USE_LG2_LOGGER
+    static AsyncRingLogger<> backend(AsyncRingLogger<>::Sink::Journal);
+    static Logger<AsyncRingLogger<>> logger(LogLevel::ERROR, backend);
+#else
+    static AsyncRingLogger<> backend(AsyncRingLogger<>::Sink::Fd,
+                                     STDERR_FILENO);
+    static Logger<AsyncRingLogger<>> logger(LogLevel::DEBUG, backend);
+#endif
+    return logger;
+}
+#elif defined(USE_LG2_LOGGER)
 inline Logger<Lg2Logger>& getLogger()
 {
     static Lg2Logger backend;
@@ -175,23 +210,23 @@ inline Logger<OStreamLogger>& getLogger()
 #undef LOG_ERROR
 
 // Logging macros.  The level prefix is derived from the LogLevel enum so it
-// cannot drift out of sync with the enum definition.
+// cannot drift out of sync with the enum definition.  Arguments are only
+// formatted when the level is enabled, so disabled LOG_DEBUG lines cost a
+// comparison, and enabled ones are formatted in place (Logger::logFormat).
+#define REACTOR_LOG(level, message, ...)                                       \
+    (NSNAME::getLogger().isEnabled(level)                                      \
+         ? NSNAME::getLogger().logFormat(std::source_location::current(),      \
+                                         level,                                \
+                                         message __VA_OPT__(, ) __VA_ARGS__)   \
+         : void())
 #define LOG_DEBUG(message, ...)                                                \
-    NSNAME::getLogger().log(std::source_location::current(),                   \
-                            NSNAME::LogLevel::DEBUG,                           \
-                            std::format(message __VA_OPT__(,) __VA_ARGS__))
+    REACTOR_LOG(NSNAME::LogLevel::DEBUG, message __VA_OPT__(, ) __VA_ARGS__)
 #define LOG_INFO(message, ...)                                                 \
-    NSNAME::getLogger().log(std::source_location::current(),                   \
-                            NSNAME::LogLevel::INFO,                            \
-                            std::format(message __VA_OPT__(,) __VA_ARGS__))
+    REACTOR_LOG(NSNAME::LogLevel::INFO, message __VA_OPT__(, ) __VA_ARGS__)
 #define LOG_WARNING(message, ...)                                              \
-    NSNAME::getLogger().log(std::source_location::current(),                   \
-                            NSNAME::LogLevel::WARNING,                         \
-                            std::format(message __VA_OPT__(,) __VA_ARGS__))
+    REACTOR_LOG(NSNAME::LogLevel::WARNING, message __VA_OPT__(, ) __VA_ARGS__)
 #define LOG_ERROR(message, ...)                                                \
-    NSNAME::getLogger().log(std::source_location::current(),                   \
-                            NSNAME::LogLevel::ERROR,                           \
-                            std::format(message __VA_OPT__(,) __VA_ARGS__))
+    REACTOR_LOG(NSNAME::LogLevel::ERROR, message __VA_OPT__(, ) __VA_ARGS__)
 
 #define CLIENT_LOG_DEBUG(message, ...)   LOG_DEBUG(message, ##__VA_ARGS__)
 #define CLIENT_LOG_INFO(message, ...)    LOG_INFO(message, ##__VA_ARGS__)
@@ -0,0 +1,159 @@
+#pragma once
+#include "logger.hpp"
+#include "make_awaitable.hpp"
+
+#include <boost/asio.hpp>
+
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+namespace NSNAME
+{
+/**
+ * @brief A fixed set of single-threaded reactors.
+ *
+ * Each reactor is an io_context driven by exactly one thread, so everything
+ * spawned on one reactor (an accepted connection, its timers, its handlers)
+ * keeps running on that thread and never needs locking. Servers are created
+ * once per reactor, each with its own acceptor bound with SO_REUSEPORT, and
+ * the kernel balances new connections across them.
+ *
+ * Work crosses reactors only through post() or runOn():
+ * @code
+ * // fire and forget on reactor 2
+ * pool.post(2, [] { LOG_INFO("on reactor 2"); });
+ *
+ * // from a coroutine: run on reactor 0 and resume on the caller's reactor
+ * auto count = co_await pool.runOn(
+ *     0, [&]() -> net::awaitable<std::size_t> { co_return cache.size(); });
+ * @endcode
+ *
+ * Multiple reactors need Asio's thread support, i.e. a build with
+ * -Dreactor_threads=enabled. Without it the pool always has one reactor.
+ */
+class ReactorPool
+{
+  public:
+    explicit ReactorPool(
+        std::size_t count = std::thread::hardware_concurrency())
+    {
+#ifdef BOOST_ASIO_DISABLE_THREADS
+        if (count > 1)
+        {
+            LOG_WARNING(
+                "Built with BOOST_ASIO_DISABLE_THREADS; using 1 reactor instead of {}",
+                count);
+        }
+        count = 1;
+#endif
+        count = std::max<std::size_t>(count, 1);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            contexts.emplace_back(std::make_unique<net::io_context>(1));
+            guards.emplace_back(contexts.back()->get_executor());
+        }
+    }
+    ReactorPool(const ReactorPool&) = delete;
+    ReactorPool& operator=(const ReactorPool&) = delete;
+    ~ReactorPool()
+    {
+        stop();
+    }
+
+    std::size_t size() const
+    {
+        return contexts.size();
+    }
+    net::io_context& context(std::size_t index)
+    {
+        return *contexts[index];
+    }
+    net::any_io_executor executor(std::size_t index)
+    {
+        return contexts[index]->get_executor();
+    }
+
+    // Index of the reactor driving the calling thread, if any.
+    static std::optional<std::size_t> currentIndex()
+    {
+        return current();
+    }
+
+    // Create one object per reactor, e.g. an acceptor and a server.
+    template <typename Make>
+    auto perReactor(Make&& make)
+    {
+        std::vector<decltype(make(std::size_t{}))> result;
+        result.reserve(size());
+        for (std::size_t i = 0; i < size(); i++)
+        {
+            result.emplace_back(make(i));
+        }
+        return result;
+    }
+
+    template <typename Handler>
+    void post(std::size_t index, Handler&& handler)
+    {
+        net::post(executor(index), std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    void postToAll(const Handler& handler)
+    {
+        for (std::size_t i = 0; i < size(); i++)
+        {
+            post(i, handler);
+        }
+    }
+
+    // Run an awaitable factory on reactor index. The calling coroutine is
+    // resumed on its own executor once the work completes.
+    template <typename Factory>
+    auto runOn(std::size_t index, Factory&& factory)
+    {
+        return net::co_spawn(executor(index), std::forward<Factory>(factory),
+                             net::use_awaitable);
+    }
+
+    // Runs reactor 0 on the calling thread and the others on worker threads.
+    // Returns once every reactor has stopped.
+    void run()
+    {
+        for (std::size_t i = 1; i < size(); i++)
+        {
+            threads.emplace_back([this, i] { runReactor(i); });
+        }
+        runReactor(0);
+        threads.clear(); // joins
+    }
+
+    void stop()
+    {
+        guards.clear();
+        for (auto& ctx : contexts)
+        {
+            ctx->stop();
+        }
+    }
+
+  private:
+    static std::optional<std::size_t>& current()
+    {
+        static thread_local std::optional<std::size_t> index;
+        return index;
+    }
+    void runReactor(std::size_t index)
+    {
+        current() = index;
+        contexts[index]->run();
+        current().reset();
+    }
+
+    std::vector<std::unique_ptr<net::io_context>> contexts;
+    std::vector<net::executor_work_guard<net::io_context::executor_type>>
+        guards;
+    std::vector<std::jthread> threads;
+};
+} // namespace NSNAME
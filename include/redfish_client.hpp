@@ -19,7 +19,7 @@ struct RedfishClient
         std::map<std::string, std::string> params;
         int version{11};
         std::map<std::string, std::string> headers;
-        bool keepAlive{false};
+        bool keepAlive{true};
 
         Request& withMethod(http::verb m)
         {
@@ -99,6 +99,7 @@ struct RedfishClient
         WebClient<beast::tcp_stream> webClient(ioc, ctx);
         webClient.withHost(host)
             .withPort(port)
+            .withPool(getConnectionPool(ioc))
             .withMethod(http::verb::post)
             .withTarget("/redfish/v1/SessionService/Sessions")
             .withHeaders({{"Content-Type", "application/json"}})
@@ -119,6 +120,14 @@ struct RedfishClient
         std::string token = res.base().at("X-Auth-Token");
         co_return std::make_tuple(boost::system::error_code{}, token);
     }
+    // The caller's headers plus the session token.
+    std::map<std::string, std::string> headersFor(const Request& req) const
+    {
+        auto headers = req.headers;
+        headers["X-Auth-Token"] = token;
+        headers.try_emplace("Content-Type", "application/json");
+        return headers;
+    }
     AwaitableResult<Response> execute(const Request& req)
     {
         int retryCount = 0;
@@ -127,13 +136,12 @@ struct RedfishClient
             WebClient<beast::tcp_stream> webClient(ioc, ctx);
             webClient.withHost(host)
                 .withPort(port)
+                .withPool(getConnectionPool(ioc))
                 .withMethod(req.method)
                 .withTarget(req.target)
-                .withHeaders(req.headers)
+                .withHeaders(headersFor(req))
                 .withBody(req.body)
                 .witKeepAlive(req.keepAlive);
-            webClient.withHeaders({{"X-Auth-Token", token},
-                                   {"Content-Type", "application/json"}});
 
             auto [ec, res] = co_await webClient.execute<Response>();
             if (ec)
@@ -161,5 +169,48 @@ struct RedfishClient
             co_return std::make_tuple(ec, res);
         }
     }
+    // execute() for callers that relay the body as it arrives. A 401 is
+    // answered by refreshing the token before anything is handed back.
+    AwaitableResult<std::shared_ptr<ResponseStream>>
+        executeStreamed(const Request& req)
+    {
+        int retryCount = 0;
+        while (true)
+        {
+            WebClient<beast::tcp_stream> webClient(ioc, ctx);
+            webClient.withHost(host)
+                .withPort(port)
+                .withPool(getConnectionPool(ioc))
+                .withMethod(req.method)
+                .withTarget(req.target)
+                .withHeaders(headersFor(req))
+                .withBody(req.body)
+                .witKeepAlive(req.keepAlive);
+
+            auto [ec, stream] = co_await webClient.executeStreamed();
+            if (ec)
+            {
+                LOG_ERROR("Error executing request: {}", ec.message());
+                co_return std::make_tuple(ec, nullptr);
+            }
+            if (stream->header().result() !=
+                    boost::beast::http::status::unauthorized ||
+                ++retryCount == 3)
+            {
+                co_return std::make_tuple(ec, std::move(stream));
+            }
+            LOG_ERROR("Request failed with status: {} for target: {}",
+                      http_error_to_string.at(stream->header().result()),
+                      req.target);
+            stream.reset(); // the unread error body goes with the connection
+            auto [tokenEc, newToken] = co_await getToken();
+            if (tokenEc)
+            {
+                LOG_ERROR("Failed to get token: {}", tokenEc.message());
+                co_return std::make_tuple(tokenEc, nullptr);
+            }
+            token = newToken;
+        }
+    }
 };
 } // namespace NSNAME
@@ -0,0 +1,178 @@
+#pragma once
+#include "name_space.hpp"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+namespace NSNAME
+{
+// Path parameters captured while matching a route. The names point into the
+// trie and the values point into the matched path, so nothing is copied.
+struct RouteParams
+{
+    static constexpr std::size_t maxParams = 16;
+    using value_type = std::pair<std::string_view, std::string_view>;
+
+    std::array<value_type, maxParams> items;
+    std::size_t count{0};
+
+    auto begin() const
+    {
+        return items.begin();
+    }
+    auto end() const
+    {
+        return items.begin() + count;
+    }
+    std::size_t size() const
+    {
+        return count;
+    }
+    std::string_view operator[](std::string_view name) const
+    {
+        auto iter = std::find_if(begin(), end(),
+                                 [&](auto& p) { return p.first == name; });
+        return iter != end() ? iter->second : std::string_view{};
+    }
+};
+
+// Segment trie used by HttpRouter. Routes are split on '/' once, at
+// registration; a segment written as "{name}" matches any single segment of
+// the request path and is captured under "name". Literal segments win over
+// parameters, and matching backtracks when a literal branch dead-ends.
+template <typename Value>
+class RouteTrie
+{
+    struct Node
+    {
+        using Child = std::pair<std::string, std::unique_ptr<Node>>;
+        std::vector<Child> literals; // sorted by segment
+        std::vector<Child> params;   // keyed by parameter name
+        std::optional<Value> value;
+    };
+
+  public:
+    // Returns the slot for path, creating it when needed.
+    Value& operator[](std::string_view path)
+    {
+        Node* node = &root;
+        std::size_t pos = 0;
+        while (pos <= path.size())
+        {
+            auto segment = nextSegment(path, pos);
+            node = isParam(segment)
+                       ? &childFor(node->params,
+                                   segment.substr(1, segment.size() - 2), false)
+                       : &childFor(node->literals, segment, true);
+        }
+        if (!node->value)
+        {
+            node->value.emplace();
+            ++routes;
+        }
+        return *node->value;
+    }
+
+    // Finds the route registered for path. Does not allocate.
+    Value* match(std::string_view path, RouteParams& params)
+    {
+        params.count = 0;
+        return match(root, path, 0, params);
+    }
+
+    std::size_t size() const
+    {
+        return routes;
+    }
+
+  private:
+    static bool isParam(std::string_view segment)
+    {
+        return segment.size() >= 2 && segment.front() == '{' &&
+               segment.back() == '}';
+    }
+
+    // Returns the segment starting at pos and moves pos past the following
+    // '/'. Once the last segment is consumed pos is beyond path.size().
+    static std::string_view nextSegment(std::string_view path, std::size_t& pos)
+    {
+        auto end = path.find('/', pos);
+        if (end == std::string_view::npos)
+        {
+            auto segment = path.substr(pos);
+            pos = path.size() + 1;
+            return segment;
+        }
+        auto segment = path.substr(pos, end - pos);
+        pos = end + 1;
+        return segment;
+    }
+
+    static auto lowerBound(std::vector<typename Node::Child>& children,
+                           std::string_view key)
+    {
+        return std::lower_bound(
+            children.begin(), children.end(), key,
+            [](const auto& child, std::string_view k) {
+                return std::string_view(child.first) < k;
+            });
+    }
+
+    static Node& childFor(std::vector<typename Node::Child>& children,
+                          std::string_view key, bool sorted)
+    {
+        auto iter = sorted ? lowerBound(children, key)
+                           : std::find_if(children.begin(), children.end(),
+                                          [&](auto& c) { return c.first == key; });
+        if (iter != children.end() && iter->first == key)
+        {
+            return *iter->second;
+        }
+        iter = children.emplace(sorted ? iter : children.end(), std::string(key),
+                                std::make_unique<Node>());
+        return *iter->second;
+    }
+
+    Value* match(Node& node, std::string_view path, std::size_t pos,
+                 RouteParams& params)
+    {
+        if (pos > path.size())
+        {
+            return node.value ? &*node.value : nullptr;
+        }
+        auto segment = nextSegment(path, pos);
+
+        auto iter = lowerBound(node.literals, segment);
+        if (iter != node.literals.end() && iter->first == segment)
+        {
+            if (auto* found = match(*iter->second, path, pos, params))
+            {
+                return found;
+            }
+        }
+        if (params.count == RouteParams::maxParams)
+        {
+            return nullptr;
+        }
+        for (auto& [name, child] : node.params)
+        {
+            auto saved = params.count;
+            params.items[params.count++] = {name, segment};
+            if (auto* found = match(*child, path, pos, params))
+            {
+                return found;
+            }
+            params.count = saved;
+        }
+        return nullptr;
+    }
+
+    Node root;
+    std::size_t routes{0};
+};
+} // namespace NSNAME
@@ -2,6 +2,9 @@
 #include "beastdefs.hpp"
 #include "logger.hpp"
 #include "make_awaitable.hpp"
+#include "tls_session.hpp"
+
+#include <sys/sendfile.h>
 
 #include <boost/asio.hpp>
 #include <boost/asio/spawn.hpp>
@@ -29,6 +32,26 @@ concept HandlerAcceptsErrorCode =
         { h(std::move(socket), ec) } -> std::same_as<void>;
     };
 
+// SO_REUSEPORT lets several acceptors, one per reactor thread, bind the same
+// port; the kernel then spreads incoming connections across them.
+using reuse_port = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+inline tcp::acceptor makeTcpAcceptor(net::any_io_executor io_context,
+                                     const tcp::endpoint& endpoint,
+                                     bool reusePort)
+{
+    tcp::acceptor acceptor(io_context);
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+    if (reusePort)
+    {
+        acceptor.set_option(reuse_port(true));
+    }
+    acceptor.bind(endpoint);
+    acceptor.listen();
+    return acceptor;
+}
+
 // Base template for stream types with SSL support
 template <typename SocketType,
           typename StreamWrapper = boost::asio::ssl::stream<SocketType>>
@@ -47,17 +70,25 @@ struct TcpStreamType :
     boost::asio::ssl::context& ssl_context_;
 
     TcpStreamType(net::any_io_executor io_context, short port,
-                  boost::asio::ssl::context& ssl_context) :
-        acceptor_(io_context, tcp::endpoint(tcp::v4(), port)),
+                  boost::asio::ssl::context& ssl_context,
+                  bool reusePort = false) :
+        acceptor_(makeTcpAcceptor(io_context, tcp::endpoint(tcp::v4(), port),
+                                  reusePort)),
         context(io_context), ssl_context_(ssl_context)
-    {}
+    {
+        enableSessionResumption(ssl_context_);
+    }
 
     TcpStreamType(net::any_io_executor io_context, const std::string& ip,
-                  short port, boost::asio::ssl::context& ssl_context) :
-        acceptor_(io_context,
-                  tcp::endpoint(boost::asio::ip::make_address(ip), port)),
+                  short port, boost::asio::ssl::context& ssl_context,
+                  bool reusePort = false) :
+        acceptor_(makeTcpAcceptor(
+            io_context, tcp::endpoint(boost::asio::ip::make_address(ip), port),
+            reusePort)),
         context(io_context), ssl_context_(ssl_context)
-    {}
+    {
+        enableSessionResumption(ssl_context_);
+    }
 
     template <typename Handler>
     void accept(Handler&& handler)
@@ -67,6 +98,15 @@ struct TcpStreamType :
             socket->lowest_layer(),
             [this, socket, handler = std::move(handler)](
                 boost::system::error_code ec) mutable {
+                if (!ec)
+                {
+                    // TLS 1.3 tickets follow the handshake as a separate
+                    // small write; Nagle would hold the first response
+                    // back until the client ACKs them.
+                    boost::system::error_code ignored;
+                    socket->lowest_layer().set_option(tcp::no_delay(true),
+                                                      ignored);
+                }
                 if constexpr (HandlerAcceptsErrorCode<Handler, stream_type>)
                 {
                     handler(std::move(socket), ec);
@@ -107,15 +147,18 @@ struct TcpStreamTypePlain : StreamTypeBase<tcp::socket, tcp::socket>
     tcp::acceptor acceptor_;
     net::any_io_executor context;
 
-    TcpStreamTypePlain(net::any_io_executor io_context, short port) :
-        acceptor_(io_context, tcp::endpoint(tcp::v4(), port)),
+    TcpStreamTypePlain(net::any_io_executor io_context, short port,
+                       bool reusePort = false) :
+        acceptor_(makeTcpAcceptor(io_context, tcp::endpoint(tcp::v4(), port),
+                                  reusePort)),
         context(io_context)
     {}
 
     TcpStreamTypePlain(net::any_io_executor io_context, const std::string& ip,
-                       short port) :
-        acceptor_(io_context,
-                  tcp::endpoint(boost::asio::ip::make_address(ip), port)),
+                       short port, bool reusePort = false) :
+        acceptor_(makeTcpAcceptor(
+            io_context, tcp::endpoint(boost::asio::ip::make_address(ip), port),
+            reusePort)),
         context(io_context)
     {}
 
@@ -176,7 +219,9 @@ struct UnixStreamType :
         acceptor_(io_context,
                   boost::asio::local::stream_protocol::endpoint(path)),
         context(io_context), ssl_context_(ssl_context)
-    {}
+    {
+        enableSessionResumption(ssl_context_);
+    }
 
     template <typename Handler>
     void accept(Handler&& handler)
@@ -267,24 +312,76 @@ struct UnixStreamTypePlain :
     }
 };
 
+// Per-connection state shared by every TimedStreamer copy made for one
+// socket.
+struct StreamState
+{
+    using clock = std::chrono::steady_clock;
+
+    // Bytes received past a frame delimiter stay here and are served to the
+    // next read, so nothing read ahead is lost between calls. Single
+    // contiguous storage, so a frame can be handed out as one view.
+    boost::asio::streambuf readBuffer;
+
+    // Deadlines are plain stored values; clock::time_point::max() means no
+    // operation of that kind is pending. opDeadline is the one set through
+    // setTimeout() for connects and handshakes.
+    clock::time_point readDeadline{clock::time_point::max()};
+    clock::time_point writeDeadline{clock::time_point::max()};
+    clock::time_point opDeadline{clock::time_point::max()};
+
+    // Expiry the watchdog armed the shared timer with.
+    clock::time_point armedAt{clock::time_point::max()};
+    bool watchdogRunning{false};
+
+    clock::time_point nextDeadline() const
+    {
+        return std::min({readDeadline, writeDeadline, opDeadline});
+    }
+    void clearDeadlines()
+    {
+        readDeadline = writeDeadline = opDeadline = clock::time_point::max();
+    }
+};
+
+// Timeouts are enforced by one watchdog coroutine per connection rather than
+// by re-arming the timer around every read and write. An operation only
+// stores its deadline; the watchdog sleeps until the earliest deadline it
+// knows of, and on waking either cancels the socket (deadline passed),
+// sleeps again (deadline moved forward meanwhile) or exits (nothing pending).
+// The next timed operation starts it again. An idle watchdog only exits at
+// its last armed expiry, so close() (or cancelling the timer) stops it
+// immediately instead of leaving a wait pending on the io_context.
 template <typename StreamType>
 struct TimedStreamer
 {
+    using clock = StreamState::clock;
+    using stream_type = StreamType;
+
     TimedStreamer(std::shared_ptr<StreamType> socket,
-                  std::shared_ptr<net::steady_timer> timer) :
-        socket(socket), timer(timer)
+                  std::shared_ptr<net::steady_timer> timer,
+                  std::shared_ptr<StreamState> state =
+                      std::make_shared<StreamState>()) :
+        socket(socket), timer(timer), state(std::move(state))
     {}
     AwaitableResult<std::size_t> read(net::mutable_buffer data,
                                       bool timeout = true)
     {
+        if (auto buffered = state->readBuffer.size(); buffered > 0)
+        {
+            // Hand out what an earlier readFrame() read ahead first
+            auto bytes = net::buffer_copy(data, state->readBuffer.data());
+            state->readBuffer.consume(bytes);
+            co_return std::make_pair(boost::system::error_code{}, bytes);
+        }
         if (timeout)
         {
-            setTimeout(30s);
+            startDeadline(state->readDeadline, 30s);
         }
         boost::system::error_code ec;
         auto bytes = co_await socket->async_read_some(
             data, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-        timer->cancel();
+        endDeadline(state->readDeadline);
         co_return std::make_pair(ec, bytes);
     }
     AwaitableResult<std::size_t> readUntil(boost::asio::streambuf& buffer,
@@ -296,53 +393,46 @@ struct TimedStreamer
             boost::asio::redirect_error(net::use_awaitable, ec));
         co_return std::make_pair(ec, bytes);
     }
-    AwaitableResult<std::string> readUntil(const std::string& delim,
-                                           bool timeout = true)
+
+    // Read until delim and return the frame, delimiter included, as a view
+    // into the connection buffer. The view stays valid until consume() or the
+    // next read; call consume(frame.size()) once the frame is handled.
+    AwaitableResult<std::string_view> readFrame(std::string_view delim,
+                                                bool timeout = true)
     {
-        boost::asio::streambuf buffer;
         if (timeout)
         {
-            setTimeout(30s);
+            startDeadline(state->readDeadline, 30s);
         }
-        auto [ec, size] = co_await readUntil(buffer, delim);
-        timer->cancel();
+        boost::system::error_code ec;
+        auto size = co_await net::async_read_until(
+            *socket, state->readBuffer, delim,
+            boost::asio::redirect_error(net::use_awaitable, ec));
+        endDeadline(state->readDeadline);
+        if (ec)
+        {
+            co_return std::make_pair(ec, std::string_view{});
+        }
+        auto data = state->readBuffer.data();
+        co_return std::make_pair(
+            ec, std::string_view(static_cast<const char*>(data.data()), size));
+    }
+    void consume(std::size_t bytes)
+    {
+        state->readBuffer.consume(bytes);
+    }
+
+    AwaitableResult<std::string> readUntil(const std::string& delim,
+                                           bool timeout = true)
+    {
+        auto [ec, frame] = co_await readFrame(delim, timeout);
         if (ec)
         {
             co_return std::make_pair(ec, std::string{});
         }
-        // Use sgetn to read exactly `size` bytes from the streambuf get area.
-        // This is correct for multi-buffer sequences — unlike buffers_begin()+size
-        // which only covers the first buffer and trips an iterator bounds assertion
-        // when async_read_until reads ahead into a second internal buffer.
-        std::string ret(size, '\0');
-        buffer.sgetn(ret.data(), static_cast<std::streamsize>(size));
+        std::string ret(frame);
+        consume(frame.size());
         co_return std::make_pair(ec, std::move(ret));
-
-        // std::string ret;
-        // ret.reserve(max_size);
-        // std::array<char, 1024> data{0};
-        // while (ret.length() <= max_size - delim.length())
-        // {
-        //     auto [ec, bytes] = co_await read(net::buffer(data), timeout);
-        //     if (ec)
-        //     {
-        //         if (ec != boost::asio::error::eof)
-        //         {
-        //             LOG_DEBUG("Error reading: {}", ec.message());
-        //         }
-        //         co_return std::make_tuple(ec, std::move(ret));
-        //     }
-        //     ret.append(data.data(), bytes);
-        //     if (std::string_view{data.data(), bytes}.find(delim) !=
-        //         std::string::npos)
-        //     {
-        //         co_return std::make_tuple(boost::system::error_code{},
-        //                                   std::move(ret));
-        //     }
-        //     std::fill(data.begin(), data.end(), 0);
-        // }
-        // co_return std::make_tuple(boost::system::error_code{},
-        // std::move(ret));
     }
 
     AwaitableResult<std::size_t> write(net::const_buffer data,
@@ -350,34 +440,107 @@ struct TimedStreamer
     {
         if (timeout)
         {
-            setTimeout(30s);
+            startDeadline(state->writeDeadline, 30s);
         }
         boost::system::error_code ec;
         auto bytes = co_await socket->async_write_some(
             data, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-        timer->cancel();
+        endDeadline(state->writeDeadline);
         co_return std::make_pair(ec, bytes);
     }
-    void setTimeout(std::chrono::seconds timeout)
+
+    // Write all of a buffer sequence, gathered into as few writes as the
+    // stream allows. Unlike write(), this does not return after a partial
+    // write.
+    template <typename ConstBufferSequence>
+    AwaitableResult<std::size_t> writeAll(const ConstBufferSequence& buffers,
+                                          bool timeout = true)
     {
-        timer->expires_after(timeout);
-        timer->async_wait(
-            [socket = socket](const boost::system::error_code& ec) {
-                if (!ec)
+        if (timeout)
+        {
+            startDeadline(state->writeDeadline, 30s);
+        }
+        boost::system::error_code ec;
+        auto bytes = co_await net::async_write(
+            *socket, buffers,
+            boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        endDeadline(state->writeDeadline);
+        co_return std::make_pair(ec, bytes);
+    }
+
+    // Send size bytes of file fd from offset with sendfile(2), so the data
+    // goes from the page cache to the socket without passing through user
+    // space. Plain sockets only: a TLS stream encrypts in user space. Fails
+    // with operation_not_supported, before sending anything, if the file
+    // cannot be sent this way.
+    AwaitableResult<std::size_t> sendFile(int fd, std::uint64_t offset,
+                                          std::size_t size,
+                                          bool timeout = true)
+        requires(!SslStream<StreamType>)
+    {
+        boost::system::error_code ec;
+        socket->native_non_blocking(true, ec);
+        if (ec)
+        {
+            co_return std::make_pair(ec, std::size_t{0});
+        }
+        if (timeout)
+        {
+            startDeadline(state->writeDeadline, 30s);
+        }
+        std::size_t sent = 0;
+        auto position = static_cast<off_t>(offset);
+        while (sent < size)
+        {
+            auto n = ::sendfile(socket->native_handle(), fd, &position,
+                                size - sent);
+            if (n > 0)
+            {
+                sent += static_cast<std::size_t>(n);
+                continue;
+            }
+            if (n == 0)
+            {
+                ec = net::error::eof; // file shorter than size
+                break;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN)
+            {
+                co_await socket->async_wait(
+                    StreamType::wait_write,
+                    boost::asio::redirect_error(boost::asio::use_awaitable,
+                                                ec));
+                if (ec)
                 {
-                    if constexpr (SslStream<StreamType>)
-                    {
-                        socket->next_layer().cancel();
-                    }
-                    else
-                    {
-                        socket->cancel();
-                    }
+                    break;
                 }
-            });
+                continue;
+            }
+            ec = (errno == EINVAL || errno == ENOSYS) && sent == 0
+                     ? make_error_code(
+                           boost::system::errc::operation_not_supported)
+                     : boost::system::error_code(
+                           errno, boost::system::system_category());
+            break;
+        }
+        endDeadline(state->writeDeadline);
+        co_return std::make_pair(ec, sent);
+    }
+
+    // Bound the next operation that is not itself timed, e.g. a connect or a
+    // handshake. Cleared when the next read or write completes.
+    void setTimeout(std::chrono::seconds timeout)
+    {
+        startDeadline(state->opDeadline, timeout);
     }
     void close()
     {
+        state->clearDeadlines();
+        timer->cancel(); // stops the watchdog
         boost::system::error_code ec;
         if constexpr (SslStream<StreamType>)
         {
@@ -429,5 +592,96 @@ struct TimedStreamer
     }
     std::shared_ptr<StreamType> socket;
     std::shared_ptr<net::steady_timer> timer;
+    std::shared_ptr<StreamState> state;
+
+  private:
+    void startDeadline(clock::time_point& slot, clock::duration timeout)
+    {
+        auto deadline = clock::now() + timeout;
+        slot = deadline;
+        if (!state->watchdogRunning)
+        {
+            state->watchdogRunning = true;
+            state->armedAt = deadline;
+            timer->expires_at(deadline);
+            net::co_spawn(timer->get_executor(),
+                          watchdog(socket, timer, state), net::detached);
+            return;
+        }
+        if (deadline < state->armedAt)
+        {
+            // Only a shorter timeout than the pending one touches the timer
+            state->armedAt = deadline;
+            timer->expires_at(deadline);
+        }
+    }
+    void endDeadline(clock::time_point& slot)
+    {
+        slot = clock::time_point::max();
+        state->opDeadline = clock::time_point::max();
+    }
+
+    static void cancelSocket(StreamType& stream)
+    {
+        boost::system::error_code ec;
+        if constexpr (SslStream<StreamType>)
+        {
+            stream.next_layer().cancel(ec);
+        }
+        else
+        {
+            stream.cancel(ec);
+        }
+    }
+
+    static net::awaitable<void> watchdog(std::weak_ptr<StreamType> weakSocket,
+                                         std::shared_ptr<net::steady_timer> timer,
+                                         std::shared_ptr<StreamState> state)
+    {
+        while (true)
+        {
+            auto armed = state->armedAt;
+            boost::system::error_code ec;
+            co_await timer->async_wait(
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            auto deadline = state->nextDeadline();
+            if (ec)
+            {
+                if (state->armedAt != armed &&
+                    timer->expiry() == state->armedAt)
+                {
+                    continue; // startDeadline() pulled the expiry in
+                }
+                if (timer->expiry() != armed ||
+                    deadline == clock::time_point::max())
+                {
+                    // Another streamer took over the timer, or cancel() was
+                    // called with nothing left to guard.
+                    break;
+                }
+                // cancel() while an operation is still pending: keep guarding
+                state->armedAt = deadline;
+                timer->expires_at(deadline);
+                continue;
+            }
+            if (deadline <= clock::now())
+            {
+                if (auto socket = weakSocket.lock())
+                {
+                    cancelSocket(*socket);
+                }
+                state->clearDeadlines();
+                deadline = clock::time_point::max();
+            }
+            if (deadline == clock::time_point::max())
+            {
+                break;
+            }
+            state->armedAt = deadline;
+            timer->expires_at(deadline);
+        }
+        state->armedAt = clock::time_point::max();
+        state->watchdogRunning = false;
+    }
 };
 } // namespace NSNAME
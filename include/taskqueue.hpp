@@ -1,5 +1,6 @@
 #pragma once
 #include "tcp_client.hpp"
+#include "trace.hpp"
 
 #include <deque>
 namespace NSNAME
@@ -107,8 +108,13 @@ class TaskQueue
 
     net::awaitable<void> handleTask(NetworkTask netTask)
     {
-        auto steamer = netTask.client.get().acquire().streamer();
-        auto ec = co_await netTask.task(steamer);
+        boost::system::error_code ec;
+        {
+            TraceSpan span(TraceEvent::Task, traceId(&netTask.client.get()));
+            auto steamer = netTask.client.get().acquire().streamer();
+            ec = co_await netTask.task(steamer);
+            span.arg1 = ec ? 1 : 0;
+        }
         if (!ec)
         {
             netTask.client.get().release();
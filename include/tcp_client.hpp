@@ -1,4 +1,5 @@
 #pragma once
+#include "dns_resolver.hpp"
 #include "make_awaitable.hpp"
 #include "socket_streams.hpp"
 
@@ -17,26 +18,14 @@ namespace net = boost::asio;
 namespace ssl = boost::asio::ssl;
 using tcp = boost::asio::ip::tcp;
 
-inline AwaitableResult<net::ip::tcp::resolver::results_type> awaitable_resolve(
-    typename net::ip::tcp::resolver& resolver, const std::string& host,
-    const std::string& port)
-{
-    auto h = make_awaitable_handler<net::ip::tcp::resolver::results_type>(
-        [&](auto promise) {
-            boost::system::error_code ec;
-            auto results = resolver.resolve(host, port, ec);
-            promise.setValues(ec, results);
-        });
-    co_return co_await h();
-}
 class TcpClient
 {
   public:
     TcpClient(net::any_io_executor io_context, ssl::context& ssl_context) :
-        resolver_(io_context),
         stream_(std::make_shared<ssl::stream<tcp::socket>>(io_context,
                                                            ssl_context)),
-        timer_(std::make_shared<net::steady_timer>(io_context))
+        timer_(std::make_shared<net::steady_timer>(io_context)),
+        state_(std::make_shared<StreamState>())
     {}
     ~TcpClient()
     {
@@ -46,7 +35,7 @@ class TcpClient
     net::awaitable<boost::system::error_code> connect(const std::string& host,
                                                       const std::string& port)
     {
-        auto [ec, results] = co_await awaitable_resolve(resolver_, host, port);
+        auto [ec, endpoints] = co_await getDnsCache().resolve(host, port);
         if (ec)
         {
             LOG_ERROR("Error resolving {}:{}. Error: {}", host, port,
@@ -54,17 +43,16 @@ class TcpClient
             co_return ec;
         }
 
-        TimedStreamer streamer(stream_, timer_);
-        streamer.setTimeout(30s);
-        co_await net::async_connect(
-            stream_->next_layer(), results,
-            net::redirect_error(net::use_awaitable, ec));
+        ec = co_await connectEndpoints(stream_->next_layer(), endpoints, 30s);
         if (ec)
         {
             LOG_ERROR("Error connecting to {}:{}. Error: {}", host, port,
                       ec.message());
             co_return ec;
         }
+        getTlsSessionCache().prepare(stream_->native_handle(),
+                                     host + ":" + port);
+        TimedStreamer streamer(stream_, timer_);
         streamer.setTimeout(30s);
         co_await stream_->async_handshake(
             ssl::stream_base::client,
@@ -73,7 +61,9 @@ class TcpClient
         {
             LOG_ERROR("Error during SSL handshake with {}:{}. Error: {}", host,
                       port, ec.message());
+            co_return ec;
         }
+        getTlsStats().client.record(stream_->native_handle());
         co_return ec;
     }
 
@@ -92,7 +82,7 @@ class TcpClient
     }
     TimedStreamer<ssl::stream<tcp::socket>> streamer()
     {
-        return TimedStreamer(stream_, timer_);
+        return TimedStreamer(stream_, timer_, state_);
     }
     void close()
     {
@@ -109,8 +99,8 @@ class TcpClient
     }
 
   private:
-    tcp::resolver resolver_;
     std::shared_ptr<ssl::stream<tcp::socket>> stream_;
     std::shared_ptr<net::steady_timer> timer_;
+    std::shared_ptr<StreamState> state_;
 };
 } // namespace NSNAME
@@ -2,6 +2,7 @@
 #include "logger.hpp"
 #include "make_awaitable.hpp"
 #include "socket_streams.hpp"
+#include "trace.hpp"
 
 #include <concepts>
 #include <string>
@@ -47,18 +48,26 @@ class TcpServer
     boost::asio::awaitable<void> handle_client(
         std::shared_ptr<StreamType> socket)
     {
+        TraceSpan connectionSpan(TraceEvent::Connection, traceId(socket.get()));
         // Perform SSL handshake only for SSL streams
         if constexpr (SslStream<StreamType>)
         {
             boost::system::error_code ec;
-            co_await socket->async_handshake(
-                boost::asio::ssl::stream_base::server,
-                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            {
+                TraceSpan handshakeSpan(TraceEvent::Handshake,
+                                        traceId(socket.get()));
+                co_await socket->async_handshake(
+                    boost::asio::ssl::stream_base::server,
+                    boost::asio::redirect_error(boost::asio::use_awaitable,
+                                                ec));
+                handshakeSpan.arg1 = ec ? 1 : 0;
+            }
             if (ec)
             {
                 LOG_ERROR("SSL handshake failed: {}", ec.message());
                 co_return;
             }
+            getTlsStats().server.record(socket->native_handle());
         }
 
         if constexpr (requires { router(socket); })
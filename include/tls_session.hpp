@@ -0,0 +1,307 @@
+#pragma once
+#include "logger.hpp"
+
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+
+#include <boost/asio/ssl.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+namespace NSNAME
+{
+namespace ssl = boost::asio::ssl;
+
+// Full and abbreviated (resumed) TLS handshakes, per side.
+struct TlsStats
+{
+    struct Side
+    {
+        std::atomic<uint64_t> full{0};
+        std::atomic<uint64_t> resumed{0};
+
+        void record(SSL* ssl)
+        {
+            (SSL_session_reused(ssl) ? resumed : full)++;
+        }
+        double hitRate() const
+        {
+            auto hits = resumed.load();
+            auto total = hits + full.load();
+            return total ? static_cast<double>(hits) / total : 0.0;
+        }
+    };
+    Side client;
+    Side server;
+};
+inline TlsStats& getTlsStats()
+{
+    static TlsStats stats;
+    return stats;
+}
+
+/**
+ * @brief Client side cache of TLS sessions, keyed by SSL context and peer.
+ *
+ * prepare() offers the cached session of a peer on the next handshake.
+ * Sessions are stored from OpenSSL's new-session callback rather than read
+ * back after the handshake, because TLS 1.3 servers send their tickets after
+ * the handshake has finished. The cache holds private copies: OpenSSL marks
+ * the session of a connection that is closed without a TLS shutdown as not
+ * resumable, which is how most of our clients close.
+ */
+class TlsSessionCache
+{
+  public:
+    // Offer the session cached for peer (e.g. "host:port" or a socket path)
+    // on the next handshake of ssl, and cache the session it ends up with.
+    void prepare(SSL* ssl, const std::string& peer)
+    {
+        auto* ctx = SSL_get_SSL_CTX(ssl);
+        auto key = std::format("{}|{}", static_cast<void*>(ctx), peer);
+        std::lock_guard lock(mutex);
+        if (SSL_CTX_sess_get_new_cb(ctx) != &TlsSessionCache::onNewSession)
+        {
+            SSL_CTX_set_session_cache_mode(ctx,
+                                           SSL_SESS_CACHE_CLIENT |
+                                               SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(ctx, &TlsSessionCache::onNewSession);
+        }
+        auto it = sessions.find(key);
+        if (it != sessions.end())
+        {
+            Session copy(SSL_SESSION_dup(it->second.get()));
+            if (copy)
+            {
+                SSL_set_session(ssl, copy.get());
+            }
+        }
+        delete static_cast<std::string*>(SSL_get_ex_data(ssl, peerIndex()));
+        SSL_set_ex_data(ssl, peerIndex(), new std::string(std::move(key)));
+    }
+    void clear()
+    {
+        std::lock_guard lock(mutex);
+        sessions.clear();
+    }
+
+  private:
+    struct SessionFree
+    {
+        void operator()(SSL_SESSION* session) const
+        {
+            SSL_SESSION_free(session);
+        }
+    };
+    using Session = std::unique_ptr<SSL_SESSION, SessionFree>;
+    static constexpr std::size_t maxSessions = 1024;
+
+    // The cache key of an SSL object, owned by its ex_data slot.
+    static int peerIndex()
+    {
+        static int index = SSL_get_ex_new_index(
+            0, nullptr, nullptr, nullptr,
+            [](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) {
+                delete static_cast<std::string*>(ptr);
+            });
+        return index;
+    }
+    static int onNewSession(SSL* ssl, SSL_SESSION* session);
+
+    std::mutex mutex;
+    std::map<std::string, Session> sessions;
+};
+inline TlsSessionCache& getTlsSessionCache()
+{
+    static TlsSessionCache cache;
+    return cache;
+}
+inline int TlsSessionCache::onNewSession(SSL* ssl, SSL_SESSION* session)
+{
+    auto* key = static_cast<std::string*>(SSL_get_ex_data(ssl, peerIndex()));
+    if (key == nullptr)
+    {
+        return 0;
+    }
+    Session copy(SSL_SESSION_dup(session));
+    if (!copy || !SSL_SESSION_is_resumable(copy.get()))
+    {
+        return 0;
+    }
+    auto& cache = getTlsSessionCache();
+    std::lock_guard lock(cache.mutex);
+    if (cache.sessions.size() >= maxSessions && !cache.sessions.contains(*key))
+    {
+        cache.sessions.erase(cache.sessions.begin());
+    }
+    cache.sessions[*key] = std::move(copy);
+    return 0; // the connection keeps its own reference
+}
+
+/**
+ * @brief Session ticket keys of a server SSL context.
+ *
+ * Tickets are sealed with the current key, which is replaced every rotation
+ * interval. The previous key still opens tickets issued before the last
+ * rotation, and the client is then sent a ticket under the current key.
+ */
+class TicketKeys
+{
+  public:
+    struct Key
+    {
+        unsigned char name[16];
+        unsigned char aes[32];
+        unsigned char hmac[32];
+        std::chrono::steady_clock::time_point created;
+    };
+
+    explicit TicketKeys(std::chrono::seconds rotation) :
+        rotation(rotation), current(generate())
+    {}
+
+    Key encryptionKey()
+    {
+        std::lock_guard lock(mutex);
+        rotate();
+        return current;
+    }
+    // The key named name, and whether the ticket should be renewed.
+    std::optional<std::pair<Key, bool>> decryptionKey(const unsigned char* name)
+    {
+        std::lock_guard lock(mutex);
+        rotate();
+        if (std::memcmp(name, current.name, sizeof(current.name)) == 0)
+        {
+            return std::make_pair(current, false);
+        }
+        if (previous &&
+            std::memcmp(name, previous->name, sizeof(previous->name)) == 0)
+        {
+            return std::make_pair(*previous, true);
+        }
+        return std::nullopt;
+    }
+
+  private:
+    static Key generate()
+    {
+        Key key{};
+        if (RAND_bytes(key.name, sizeof(key.name)) <= 0 ||
+            RAND_bytes(key.aes, sizeof(key.aes)) <= 0 ||
+            RAND_bytes(key.hmac, sizeof(key.hmac)) <= 0)
+        {
+            throw std::runtime_error("Unable to generate TLS ticket key");
+        }
+        key.created = std::chrono::steady_clock::now();
+        return key;
+    }
+    void rotate()
+    {
+        if (std::chrono::steady_clock::now() - current.created >= rotation)
+        {
+            previous = current;
+            current = generate();
+        }
+    }
+
+    std::mutex mutex;
+    std::chrono::seconds rotation;
+    Key current;
+    std::optional<Key> previous;
+};
+
+namespace detail
+{
+inline int ticketKeysIndex()
+{
+    static int index = SSL_CTX_get_ex_new_index(
+        0, nullptr, nullptr, nullptr,
+        [](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) {
+            delete static_cast<TicketKeys*>(ptr);
+        });
+    return index;
+}
+inline int ticketKeyCallback(SSL* ssl, unsigned char* name, unsigned char* iv,
+                             EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac, int enc)
+{
+    auto* keys = static_cast<TicketKeys*>(
+        SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ticketKeysIndex()));
+    if (keys == nullptr)
+    {
+        return -1;
+    }
+    TicketKeys::Key key;
+    bool renew = false;
+    if (enc)
+    {
+        key = keys->encryptionKey();
+        std::memcpy(name, key.name, sizeof(key.name));
+        if (RAND_bytes(iv, EVP_CIPHER_get_iv_length(EVP_aes_256_cbc())) <= 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        auto found = keys->decryptionKey(name);
+        if (!found)
+        {
+            return 0; // unknown or retired key: full handshake
+        }
+        std::tie(key, renew) = *found;
+    }
+    char digest[] = "SHA256";
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmac,
+                                          sizeof(key.hmac)),
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+        OSSL_PARAM_construct_end()};
+    if (!EVP_MAC_CTX_set_params(mac, params))
+    {
+        return -1;
+    }
+    auto init = enc ? EVP_EncryptInit_ex : EVP_DecryptInit_ex;
+    if (!init(cipher, EVP_aes_256_cbc(), nullptr, key.aes, iv))
+    {
+        return -1;
+    }
+    return renew ? 2 : 1;
+}
+} // namespace detail
+
+/**
+ * @brief Let clients resume sessions with a server SSL context.
+ *
+ * Enables the server session cache and stateless session tickets with keys
+ * rotated every rotation interval. A resumed session is accepted for at
+ * most one interval. Calling it again on the same context does nothing.
+ */
+inline void enableSessionResumption(
+    ssl::context& context,
+    std::chrono::seconds rotation = std::chrono::hours(1))
+{
+    auto* ctx = context.native_handle();
+    if (SSL_CTX_get_ex_data(ctx, detail::ticketKeysIndex()) != nullptr)
+    {
+        return;
+    }
+    SSL_CTX_set_ex_data(ctx, detail::ticketKeysIndex(),
+                        new TicketKeys(rotation));
+    static constexpr unsigned char sessionContext[] = "coroserver";
+    SSL_CTX_set_session_id_context(ctx, sessionContext,
+                                   sizeof(sessionContext) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_timeout(ctx, static_cast<long>(rotation.count()));
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, detail::ticketKeyCallback);
+}
+} // namespace NSNAME
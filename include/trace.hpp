@@ -0,0 +1,270 @@
+#pragma once
+#include "logger.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace NSNAME
+{
+
+// Points in the reactor that emit trace records. Append only: the numbers
+// are stored in trace files.
+enum class TraceEvent : std::uint16_t
+{
+    Connection, // TcpServer / HttpServer handle_client, id = socket
+    Handshake,  // TLS handshake, id = socket; arg1 = 1 on failure
+    Request,    // one HTTP request, id = request; arg0 = method
+    Route,      // HttpRouter::process_request, id = request; arg1 = status
+    Write,      // writing the response, id = request; arg1 = 1 on failure
+    Task,       // TaskQueue::handleTask, id = client; arg1 = 1 on failure
+    EventSend,  // EventQueue::sendEventHandler, id = event id; arg0 = size,
+                // arg1 = 1 on failure
+};
+
+enum class TracePhase : std::uint8_t
+{
+    Begin,
+    End,
+    Instant
+};
+
+constexpr std::string_view traceEventName(TraceEvent event) noexcept
+{
+    switch (event)
+    {
+        case TraceEvent::Connection: return "Connection";
+        case TraceEvent::Handshake:  return "Handshake";
+        case TraceEvent::Request:    return "Request";
+        case TraceEvent::Route:      return "Route";
+        case TraceEvent::Write:      return "Write";
+        case TraceEvent::Task:       return "Task";
+        case TraceEvent::EventSend:  return "EventSend";
+    }
+    return "Unknown";
+}
+
+// One record; begin and end records of a span share event and id.
+struct TraceRecord
+{
+    std::uint64_t timestampNs; // steady_clock
+    std::uint64_t id;
+    std::uint64_t arg0;
+    std::uint64_t arg1;
+    std::uint32_t tid;
+    std::uint16_t event;
+    std::uint8_t phase;
+    std::uint8_t reserved;
+};
+static_assert(sizeof(TraceRecord) == 40);
+
+// Start of every trace file, followed by capacity records. Record n of the
+// thread is at index n % capacity; count is the number written so far.
+struct TraceFileHeader
+{
+    static constexpr std::array<char, 8> expectedMagic{'R', 'T', 'R', 'A',
+                                                       'C', 'E', '0', '1'};
+    std::array<char, 8> magic;
+    std::uint32_t recordSize;
+    std::uint32_t capacity;
+    std::uint32_t pid;
+    std::uint32_t tid;
+    std::uint64_t count;
+};
+
+// A memory-mapped trace file written by one thread. Being MAP_SHARED, what
+// was recorded reaches the file even if the process crashes.
+class TraceRing
+{
+  public:
+    TraceRing(const std::string& path, std::uint32_t capacity) :
+        capacity(capacity)
+    {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                        0644);
+        if (fd < 0)
+        {
+            LOG_ERROR("Cannot create trace file {}", path);
+            return;
+        }
+        length = sizeof(TraceFileHeader) + capacity * sizeof(TraceRecord);
+        void* mem = MAP_FAILED;
+        if (::ftruncate(fd, static_cast<off_t>(length)) == 0)
+        {
+            mem = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd, 0);
+        }
+        ::close(fd);
+        if (mem == MAP_FAILED)
+        {
+            LOG_ERROR("Cannot map trace file {}", path);
+            return;
+        }
+        header = static_cast<TraceFileHeader*>(mem);
+        header->magic = TraceFileHeader::expectedMagic;
+        header->recordSize = sizeof(TraceRecord);
+        header->capacity = capacity;
+        header->pid = static_cast<std::uint32_t>(::getpid());
+        header->tid = static_cast<std::uint32_t>(::gettid());
+        header->count = 0;
+        records = reinterpret_cast<TraceRecord*>(header + 1);
+    }
+    TraceRing(const TraceRing&) = delete;
+    TraceRing& operator=(const TraceRing&) = delete;
+    ~TraceRing()
+    {
+        if (header != nullptr)
+        {
+            ::munmap(header, length);
+        }
+    }
+
+    void record(TraceEvent event, TracePhase phase, std::uint64_t id,
+                std::uint64_t arg0, std::uint64_t arg1)
+    {
+        if (header == nullptr)
+        {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        TraceRecord& r = records[header->count % capacity];
+        r.timestampNs = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+        r.id = id;
+        r.arg0 = arg0;
+        r.arg1 = arg1;
+        r.tid = header->tid;
+        r.event = static_cast<std::uint16_t>(event);
+        r.phase = static_cast<std::uint8_t>(phase);
+        r.reserved = 0;
+        header->count++;
+    }
+
+  private:
+    std::uint32_t capacity;
+    std::size_t length{0};
+    TraceFileHeader* header{nullptr};
+    TraceRecord* records{nullptr};
+};
+
+// Binary tracing of the reactor's hot paths, off unless started. Each
+// thread that records gets its own ring file
+// <directory>/trace.<pid>.<tid>.<generation>, so recording takes no lock and
+// formats nothing, and a later start() leaves earlier captures in place.
+// The thread owns the mapping and releases it when it exits or records into
+// a newer generation. Setting REACTOR_TRACE_DIR starts it at the first
+// record; trace_decoder turns the files into Chrome trace JSON.
+class Tracer
+{
+  public:
+    Tracer()
+    {
+        if (const char* dir = std::getenv("REACTOR_TRACE_DIR"))
+        {
+            start(dir);
+        }
+    }
+
+    // Trace into directory, recordsPerThread records before a thread's file
+    // wraps around. Each start() begins new files.
+    void start(std::string directory, std::uint32_t recordsPerThread = 65536)
+    {
+        if (recordsPerThread == 0)
+        {
+            LOG_ERROR("Trace not started: a ring needs at least one record");
+            return;
+        }
+        std::lock_guard lock(mutex);
+        dir = std::move(directory);
+        capacity = recordsPerThread;
+        generation.fetch_add(1, std::memory_order_relaxed);
+        enabled.store(true, std::memory_order_release);
+    }
+    void stop()
+    {
+        enabled.store(false, std::memory_order_release);
+    }
+    bool isEnabled() const noexcept
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void record(TraceEvent event, TracePhase phase, std::uint64_t id,
+                std::uint64_t arg0 = 0, std::uint64_t arg1 = 0)
+    {
+        if (!isEnabled())
+        {
+            return;
+        }
+        thread_local std::unique_ptr<TraceRing> ring;
+        thread_local std::uint64_t ringGeneration = 0;
+        auto current = generation.load(std::memory_order_relaxed);
+        if (ring == nullptr || ringGeneration != current)
+        {
+            ring = openRing(current);
+            ringGeneration = current;
+        }
+        ring->record(event, phase, id, arg0, arg1);
+    }
+
+  private:
+    // A ring for the calling thread, which alone writes to it.
+    std::unique_ptr<TraceRing> openRing(std::uint64_t ringGeneration)
+    {
+        std::lock_guard lock(mutex);
+        auto path = std::format("{}/trace.{}.{}.{}", dir, ::getpid(),
+                                ::gettid(), ringGeneration);
+        return std::make_unique<TraceRing>(path, capacity);
+    }
+
+    std::atomic<bool> enabled{false};
+    std::atomic<std::uint64_t> generation{0};
+    std::mutex mutex;
+    std::string dir;
+    std::uint32_t capacity{65536};
+};
+
+inline Tracer& getTracer()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+// Records the begin of a span now and its end when it goes out of scope.
+// Set arg1 before then to attach a result to the end record.
+struct TraceSpan
+{
+    TraceSpan(TraceEvent event, std::uint64_t id, std::uint64_t arg0 = 0) :
+        event(event), id(id)
+    {
+        getTracer().record(event, TracePhase::Begin, id, arg0);
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    ~TraceSpan()
+    {
+        getTracer().record(event, TracePhase::End, id, 0, arg1);
+    }
+
+    TraceEvent event;
+    std::uint64_t id;
+    std::uint64_t arg1{0};
+};
+
+// Span ids are the addresses of the objects they follow.
+inline std::uint64_t traceId(const void* object) noexcept
+{
+    return reinterpret_cast<std::uintptr_t>(object);
+}
+
+} // namespace NSNAME
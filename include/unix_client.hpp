@@ -28,7 +28,8 @@ class UnixClient
     UnixClient(net::any_io_executor io_context, ssl::context& ssl_context) :
         stream_(std::make_shared<ssl::stream<unix_domain::socket>>(
             io_context, ssl_context)),
-        timer_(std::make_shared<net::steady_timer>(io_context))
+        timer_(std::make_shared<net::steady_timer>(io_context)),
+        state_(std::make_shared<StreamState>())
     {}
     ~UnixClient()
     {
@@ -49,6 +50,7 @@ class UnixClient
             LOG_ERROR("Error connecting to {}. Error: {}", path, ec.message());
             co_return ec;
         }
+        getTlsSessionCache().prepare(stream_->native_handle(), path);
         streamer.setTimeout(30s);
         co_await stream_->async_handshake(
             ssl::stream_base::client,
@@ -57,7 +59,9 @@ class UnixClient
         {
             LOG_ERROR("Error during SSL handshake with {}. Error: {}", path,
                       ec.message());
+            co_return ec;
         }
+        getTlsStats().client.record(stream_->native_handle());
         co_return ec;
     }
 
@@ -76,7 +80,7 @@ class UnixClient
     }
     TimedStreamer<ssl::stream<unix_domain::socket>> streamer()
     {
-        return TimedStreamer(stream_, timer_);
+        return TimedStreamer(stream_, timer_, state_);
     }
     void close()
     {
@@ -95,6 +99,7 @@ class UnixClient
   private:
     std::shared_ptr<ssl::stream<unix_domain::socket>> stream_;
     std::shared_ptr<net::steady_timer> timer_;
+    std::shared_ptr<StreamState> state_;
 };
 
 // Plain (non-SSL) Unix Client
@@ -103,7 +108,8 @@ class UnixClientPlain
   public:
     UnixClientPlain(net::any_io_executor io_context) :
         stream_(std::make_shared<unix_domain::socket>(io_context)),
-        timer_(std::make_shared<net::steady_timer>(io_context))
+        timer_(std::make_shared<net::steady_timer>(io_context)),
+        state_(std::make_shared<StreamState>())
     {}
     ~UnixClientPlain()
     {
@@ -175,7 +181,7 @@ class UnixClientPlain
     }
     TimedStreamer<unix_domain::socket> streamer()
     {
-        return TimedStreamer(stream_, timer_);
+        return TimedStreamer(stream_, timer_, state_);
     }
     void close()
     {
@@ -194,5 +200,6 @@ class UnixClientPlain
   private:
     std::shared_ptr<unix_domain::socket> stream_;
     std::shared_ptr<net::steady_timer> timer_;
+    std::shared_ptr<StreamState> state_;
 };
 } // namespace NSNAME
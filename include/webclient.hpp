@@ -1,10 +1,14 @@
 #pragma once
 #include "boost/url.hpp"
+#include "connection_pool.hpp"
 #include "http_client.hpp"
 
 #include <nlohmann/json.hpp>
 
+#include <array>
+#include <limits>
 #include <map>
+#include <memory>
 #include <optional>
 namespace NSNAME
 {
@@ -63,6 +67,85 @@ struct SseStream
     std::optional<SseFrame> slot_;
 };
 
+/// Response returned by executeStreamed() whose body is still on the wire.
+/// Each next() reads one piece into a fixed buffer owned by the stream, so the
+/// body is relayed at the pace of the consumer and never held in full. The
+/// leased connection goes back to the pool once the body has been read to the
+/// end; dropping the stream earlier closes it.
+class ResponseStream
+{
+  public:
+    explicit ResponseStream(ConnectionPool::Lease lease) :
+        lease(std::move(lease))
+    {
+        parser.body_limit(std::numeric_limits<std::uint64_t>::max());
+    }
+
+    net::awaitable<boost::system::error_code> readHeader(bool headRequest)
+    {
+        // A response to HEAD announces a length but carries no body.
+        parser.skip(headRequest);
+        auto ec = co_await lease.client().read_header(parser);
+        if (!ec && parser.is_done())
+        {
+            finish();
+        }
+        co_return ec;
+    }
+    const http::response_header<>& header() const
+    {
+        return parser.get().base();
+    }
+    // True when the message has no body (HEAD, 204, 304, empty body).
+    bool done() const
+    {
+        return parser.is_done();
+    }
+
+    // The next piece of the body, valid until next() is called again, or an
+    // empty optional at the end of the body.
+    net::awaitable<
+        std::pair<boost::system::error_code, std::optional<net::const_buffer>>>
+        next()
+    {
+        if (parser.is_done())
+        {
+            finish();
+            co_return std::make_pair(boost::system::error_code{},
+                                     std::nullopt);
+        }
+        auto& body = parser.get().body();
+        body.data = buffer.data();
+        body.size = buffer.size();
+        auto ec = co_await lease.client().read_some(parser);
+        if (ec == http::error::need_buffer)
+        {
+            ec = {};
+        }
+        if (ec)
+        {
+            co_return std::make_pair(ec, std::nullopt);
+        }
+        co_return std::make_pair(
+            ec, std::optional<net::const_buffer>(
+                    net::buffer(buffer.data(), buffer.size() - body.size)));
+    }
+
+  private:
+    void finish()
+    {
+        if (parser.keep_alive())
+        {
+            lease.keepAlive();
+        }
+        lease = ConnectionPool::Lease{};
+    }
+
+    ConnectionPool::Lease lease;
+    http::response_parser<http::buffer_body> parser;
+    std::array<char, 16 * 1024> buffer;
+};
+
 template <typename T>
 concept WebClientThenFunction =
     requires(T t, Response response) {
@@ -116,7 +199,12 @@ struct WebClient
     };
     RetryPolicy retryPolicy;
     bool isConnected{false};
-    WebClient(net::io_context& ioc, ssl::context& ctx) : client(ioc, ctx)
+    // Set by withPool; requests then run on a connection leased from it.
+    ConnectionPool* pool{nullptr};
+    std::optional<ConnectionPool::Lease> lease;
+    ssl::context* sslContext;
+    WebClient(net::io_context& ioc, ssl::context& ctx) :
+        client(ioc, ctx), sslContext(&ctx)
     {
         if constexpr (std::is_same_v<Stream, beast::tcp_stream>)
         {
@@ -152,6 +240,13 @@ struct WebClient
         return *this;
     }
 
+    WebClient& withPool(ConnectionPool& p)
+    {
+        static_assert(std::is_same_v<Stream, beast::tcp_stream>);
+        pool = &p;
+        return *this;
+    }
+
     WebClient& withPort(const std::string& p)
     {
         static_assert(std::is_same_v<Stream, beast::tcp_stream>);
@@ -238,6 +333,31 @@ struct WebClient
         return *this;
     }
 
+    // The connection requests are sent on: the leased one when pooled.
+    HttpClient<Stream>& connection()
+    {
+        if constexpr (std::is_same_v<Stream, beast::tcp_stream>)
+        {
+            if (lease)
+            {
+                return lease->client();
+            }
+        }
+        return client;
+    }
+    // Hand a leased connection back; it stays open only if keep is set.
+    void releaseConnection(bool keep)
+    {
+        if (lease)
+        {
+            if (keep)
+            {
+                lease->keepAlive();
+            }
+            lease.reset();
+            isConnected = false;
+        }
+    }
     AwaitableResult<boost::system::error_code> tryConnect()
     {
         if (isConnected)
@@ -248,6 +368,25 @@ struct WebClient
         for (int i = 0; i < retryPolicy.maxTries; i++)
         {
             std::string target;
+            if constexpr (std::is_same_v<Stream, beast::tcp_stream>)
+            {
+                if (pool)
+                {
+                    auto& tcpData = std::get<TcpData>(data);
+                    target = tcpData.host;
+                    ConnectionPool::Lease leased;
+                    std::tie(ec, leased) = co_await pool->acquire(
+                        *sslContext, tcpData.host, tcpData.port);
+                    if (!ec)
+                    {
+                        lease.emplace(std::move(leased));
+                        isConnected = true;
+                        co_return ec;
+                    }
+                    LOG_INFO("Retrying {} connection to {} ", i + 1, target);
+                    continue;
+                }
+            }
             if (std::is_same_v<Stream, beast::tcp_stream>)
             {
                 auto& tcpData = std::get<TcpData>(data);
@@ -327,29 +466,104 @@ struct WebClient
         return req;
     }
 
+    // A pooled connection that served earlier requests may have been closed
+    // by the server while idle. If sending on it fails, or an idempotent
+    // request gets no response, the request is sent once more on a new
+    // connection.
+    bool retryOnFreshConnection(bool reused, bool sent) const
+    {
+        auto method = request.method;
+        bool idempotent = method == http::verb::get ||
+                          method == http::verb::head ||
+                          method == http::verb::put ||
+                          method == http::verb::delete_ ||
+                          method == http::verb::options;
+        return reused && (!sent || idempotent);
+    }
+
     template <typename... Ret>
     AwaitableResult<boost::system::error_code, Ret...> execute()
     {
-        auto [ec] = co_await tryConnect();
-        if (ec)
+        Request req = buildRequest();
+        for (int attempt = 0;; attempt++)
         {
+            auto [ec] = co_await tryConnect();
+            if (ec)
+            {
+                co_return co_await returnFailed<boost::system::error_code,
+                                                Ret...>(ec);
+            }
+            bool reused = lease && lease->reused();
+            ec = co_await connection().send_request(req);
+            bool sent = !ec;
+            Response response;
+            if (sent)
+            {
+                std::tie(ec, response) =
+                    co_await connection().receive_response();
+            }
+            if (!ec)
+            {
+                releaseConnection(response.keep_alive());
+                co_return co_await returnSuccess<boost::system::error_code,
+                                                 Ret...>(ec,
+                                                         std::move(response));
+            }
+            releaseConnection(false);
+            if (attempt == 0 && retryOnFreshConnection(reused, sent))
+            {
+                LOG_DEBUG("Stale pooled connection: {}", ec.message());
+                continue;
+            }
             co_return co_await returnFailed<boost::system::error_code, Ret...>(
                 ec);
         }
-        Request req = buildRequest();
-        ec = co_await client.send_request(req);
-        if (ec)
+    }
+
+    // Like execute(), but return as soon as the response header is in; the
+    // body is then read from the ResponseStream, which owns the connection.
+    // Needs a pool (withPool) to lease that connection from.
+    AwaitableResult<boost::system::error_code, std::shared_ptr<ResponseStream>>
+        executeStreamed()
+        requires std::is_same_v<Stream, beast::tcp_stream>
+    {
+        if (pool == nullptr)
         {
-            co_return co_await returnFailed<boost::system::error_code, Ret...>(
-                ec);
+            co_return std::make_tuple(
+                make_error_code(boost::system::errc::operation_not_supported),
+                std::shared_ptr<ResponseStream>{});
         }
-        auto [ec1, response] = co_await client.receive_response();
-        if (!ec1)
+        Request req = buildRequest();
+        for (int attempt = 0;; attempt++)
         {
-            co_return co_await returnSuccess<boost::system::error_code, Ret...>(
-                ec1, std::move(response));
+            auto [ec] = co_await tryConnect();
+            if (ec)
+            {
+                co_return std::make_tuple(ec, std::shared_ptr<ResponseStream>{});
+            }
+            bool reused = lease->reused();
+            ec = co_await connection().send_request(req);
+            bool sent = !ec;
+            auto stream = std::make_shared<ResponseStream>(std::move(*lease));
+            lease.reset();
+            isConnected = false;
+            if (sent)
+            {
+                ec = co_await stream->readHeader(request.method ==
+                                                 http::verb::head);
+            }
+            if (!ec)
+            {
+                co_return std::make_tuple(ec, std::move(stream));
+            }
+            stream.reset();
+            if (attempt == 0 && retryOnFreshConnection(reused, sent))
+            {
+                LOG_DEBUG("Stale pooled connection: {}", ec.message());
+                continue;
+            }
+            co_return std::make_tuple(ec, std::shared_ptr<ResponseStream>{});
         }
-        co_return co_await returnFailed<boost::system::error_code, Ret...>(ec1);
     }
 
     // Open a persistent SSE connection and return a shared SseStream.
@@ -371,12 +585,12 @@ struct WebClient
         req.set(http::field::cache_control, "no-cache");
         req.keep_alive(true);
 
-        ec = co_await client.send_request(req);
+        ec = co_await connection().send_request(req);
         if (ec)
             co_return std::make_pair(ec, nullptr);
 
         // 3. Read and parse the HTTP response header properly via Beast.
-        auto [hec, statusCode] = co_await client.readResponseHeader();
+        auto [hec, statusCode] = co_await connection().readResponseHeader();
         if (hec)
             co_return std::make_pair(hec, nullptr);
 
@@ -457,7 +671,7 @@ struct WebClient
     {
         while (true)
         {
-            auto [rec, frame] = co_await client.readUntil(delim);
+            auto [rec, frame] = co_await connection().readUntil(delim);
 
             if (rec == net::error::eof)
             {
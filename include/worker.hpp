@@ -1,80 +1,519 @@
 #pragma once
+#include "logger.hpp"
 #include "make_awaitable.hpp"
 
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
 #include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <semaphore>
 #include <stop_token>
 #include <thread>
 #include <utility>
 #include <vector>
 namespace NSNAME
 {
-struct WorkerPool
+// A move-only void() callable constructed in place. Callables up to
+// inlineSize bytes are stored inside the object, so putting a typical
+// asyncCall closure into a pooled slot does not allocate.
+class WorkerTask
 {
-    std::deque<std::function<void()>> task_queue;
-    std::mutex mutex;
-    std::condition_variable condition;
-    std::stop_source stop_source;
-    std::vector<std::jthread> threads;
-    std::stop_token stopToken() const
+  public:
+    static constexpr std::size_t inlineSize = 64;
+
+    WorkerTask() = default;
+    WorkerTask(const WorkerTask&) = delete;
+    WorkerTask& operator=(const WorkerTask&) = delete;
+    ~WorkerTask()
     {
-        return stop_source.get_token();
+        reset();
+    }
+
+    template <typename Func>
+    void emplace(Func&& func)
+    {
+        using F = std::decay_t<Func>;
+        if constexpr (sizeof(F) <= inlineSize &&
+                      alignof(F) <= alignof(std::max_align_t))
+        {
+            new (storage) F(std::forward<Func>(func));
+            invokeFn = [](void* p) { (*static_cast<F*>(p))(); };
+            destroyFn = [](void* p) { static_cast<F*>(p)->~F(); };
+        }
+        else
+        {
+            *reinterpret_cast<F**>(storage) = new F(std::forward<Func>(func));
+            invokeFn = [](void* p) { (**static_cast<F**>(p))(); };
+            destroyFn = [](void* p) { delete *static_cast<F**>(p); };
+        }
+    }
+    void operator()()
+    {
+        invokeFn(storage);
+    }
+    void reset()
+    {
+        if (destroyFn)
+        {
+            destroyFn(storage);
+            invokeFn = nullptr;
+            destroyFn = nullptr;
+        }
+    }
+
+  private:
+    alignas(std::max_align_t) unsigned char storage[inlineSize];
+    void (*invokeFn)(void*){nullptr};
+    void (*destroyFn)(void*){nullptr};
+};
+
+// Bounded multi-producer multi-consumer queue (Vyukov). Each cell carries a
+// sequence number telling producers and consumers whose turn it is, so push
+// and pop are a single CAS on the shared index in the common case.
+template <typename T, std::size_t Capacity>
+class BoundedMpmcQueue
+{
+    static_assert(std::has_single_bit(Capacity));
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+  public:
+    BoundedMpmcQueue()
+    {
+        for (std::size_t i = 0; i < Capacity; i++)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    bool push(T value)
+    {
+        auto pos = tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto& cell = cells[pos & (Capacity - 1)];
+            auto seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+                {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    bool pop(T& value)
+    {
+        auto pos = head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto& cell = cells[pos & (Capacity - 1)];
+            auto seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+                {
+                    value = cell.value;
+                    cell.sequence.store(pos + Capacity,
+                                        std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) >=
+               tail.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::unique_ptr<Cell[]> cells{new Cell[Capacity]};
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+// Fixed-size Chase-Lev work-stealing deque. The owning worker pushes and
+// pops at the bottom; any other worker may steal from the top.
+template <typename T, std::size_t Capacity>
+class WorkStealingDeque
+{
+    static_assert(std::has_single_bit(Capacity));
+
+  public:
+    // Owner only. Returns false when the deque is full.
+    bool push(T value)
+    {
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_acquire);
+        if (b - t >= static_cast<std::int64_t>(Capacity))
+        {
+            return false;
+        }
+        buffer[b & (Capacity - 1)].store(value, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+    // Owner only.
+    T pop()
+    {
+        auto b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return T{};
+        }
+        T value = buffer[b & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // Last element: race the thieves for it.
+            if (!top.compare_exchange_strong(t, t + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed))
+            {
+                value = T{};
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return value;
+    }
+    // Any thread. Returns T{} when empty or when another thief won.
+    T steal()
+    {
+        auto t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+        {
+            return T{};
+        }
+        T value = buffer[t & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed))
+        {
+            return T{};
+        }
+        return value;
+    }
+    bool empty() const
+    {
+        return top.load(std::memory_order_acquire) >=
+               bottom.load(std::memory_order_acquire);
     }
+
+  private:
+    alignas(64) std::atomic<std::int64_t> top{0};
+    alignas(64) std::atomic<std::int64_t> bottom{0};
+    std::unique_ptr<std::atomic<T>[]> buffer{new std::atomic<T>[Capacity]};
+};
+
+/**
+ * @brief Thread pool for blocking work offloaded from the io_context.
+ *
+ * Tasks live in a preallocated slab of WorkerTask slots; only slot pointers
+ * travel through the queues. Submissions from outside the pool go to a
+ * lock-free injection queue, submissions from a worker go to that worker's
+ * own deque, and idle workers steal from each other. A submission wakes at
+ * most one sleeping worker.
+ *
+ * When every slot is taken the task is heap allocated and parked on a
+ * mutex-protected overflow list, so addTask() never blocks or fails.
+ */
+struct WorkerPool
+{
+    static constexpr std::size_t slabSize = 1024;
+    static constexpr std::size_t dequeSize = 256;
+
     WorkerPool(unsigned num_threads = std::thread::hardware_concurrency()) :
-        threads(num_threads)
+        slab(new WorkerTask[slabSize]),
+        workers(std::max(num_threads, 1u))
     {
+        // Workers log. Statics are destroyed in the reverse order of their
+        // construction, so making sure the logger exists first keeps it alive
+        // until a static pool, like getWorkerPool(), has joined its threads.
+        getLogger();
+        for (std::size_t i = 0; i < slabSize; i++)
+        {
+            freeSlots.push(&slab[i]);
+        }
         run();
     }
     WorkerPool(const WorkerPool&) = delete;
     WorkerPool& operator=(const WorkerPool&) = delete;
     WorkerPool(WorkerPool&&) = delete;
     WorkerPool& operator=(WorkerPool&&) = delete;
-    void addTask(std::function<void()>&& task)
+
+    std::stop_token stopToken() const
     {
-        std::unique_lock<std::mutex> lock(mutex);
-        task_queue.emplace_back(std::move(task));
-        condition.notify_all();
+        return stop_source.get_token();
     }
-    void run()
+
+    template <typename Func>
+        requires std::invocable<std::decay_t<Func>&>
+    void addTask(Func&& func)
     {
-        for (auto& thread : threads)
+        WorkerTask* task = nullptr;
+        bool pooled = freeSlots.pop(task);
+        if (!pooled)
         {
-            thread = std::jthread([this]() {
-                auto token = stopToken();
-                while (!token.stop_requested())
-                {
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(mutex);
-                        condition.wait(lock, [this, token] {
-                            return !task_queue.empty() ||
-                                   token.stop_requested();
-                        });
-                        if (!token.stop_requested())
-                        {
-                            task = std::move(task_queue.front());
-                            task_queue.pop_front();
-                        }
-                    }
-                    if (!task)
-                        break;
-                    task();
-                }
-            });
+            task = new WorkerTask;
+        }
+        task->emplace(std::forward<Func>(func));
+
+        auto* self = current();
+        if (pooled && self && self->pool == this &&
+            workers[self->index].deque.push(task))
+        {
+            wakeOne();
+            return;
+        }
+        if (!pooled || !injection.push(task))
+        {
+            std::lock_guard lock(overflowMutex);
+            overflow.push_back(task);
+            overflowCount.fetch_add(1, std::memory_order_release);
         }
+        wakeOne();
     }
 
     ~WorkerPool()
     {
         stop_source.request_stop();
-        condition.notify_all();
+        wakeup.release(static_cast<std::ptrdiff_t>(workers.size()));
+        for (auto& worker : workers)
+        {
+            worker.thread = {}; // joins
+        }
+        // Drop whatever was never run.
+        WorkerTask* task = nullptr;
+        while (injection.pop(task))
+        {
+            release(task);
+        }
+        for (auto& worker : workers)
+        {
+            while ((task = worker.deque.pop()))
+            {
+                release(task);
+            }
+        }
+        for (auto* t : overflow)
+        {
+            delete t;
+        }
+    }
+
+  private:
+    struct Worker
+    {
+        WorkStealingDeque<WorkerTask*, dequeSize> deque;
+        std::jthread thread;
+    };
+    struct Current
+    {
+        WorkerPool* pool;
+        std::size_t index;
+    };
+    static Current*& current()
+    {
+        static thread_local Current* self = nullptr;
+        return self;
+    }
+
+    void run()
+    {
+        for (std::size_t i = 0; i < workers.size(); i++)
+        {
+            workers[i].thread = std::jthread([this, i]() { workerLoop(i); });
+        }
+    }
+
+    void workerLoop(std::size_t index)
+    {
+        Current self{this, index};
+        current() = &self;
+        std::minstd_rand rng(static_cast<unsigned>(index + 1));
+        auto token = stopToken();
+        while (!token.stop_requested())
+        {
+            if (auto* task = findTask(index, rng))
+            {
+                execute(task);
+                continue;
+            }
+            sleep();
+        }
+        current() = nullptr;
     }
+
+    WorkerTask* findTask(std::size_t index, std::minstd_rand& rng)
+    {
+        if (auto* task = workers[index].deque.pop())
+        {
+            return task;
+        }
+        WorkerTask* task = nullptr;
+        if (injection.pop(task))
+        {
+            return task;
+        }
+        if (overflowCount.load(std::memory_order_acquire) > 0)
+        {
+            std::lock_guard lock(overflowMutex);
+            if (!overflow.empty())
+            {
+                task = overflow.front();
+                overflow.pop_front();
+                overflowCount.fetch_sub(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        auto start = rng();
+        for (std::size_t i = 1; i < workers.size(); i++)
+        {
+            auto victim = (start + i) % workers.size();
+            if (victim == index)
+            {
+                continue;
+            }
+            if ((task = workers[victim].deque.steal()))
+            {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    bool hasWork() const
+    {
+        if (!injection.empty() ||
+            overflowCount.load(std::memory_order_acquire) > 0)
+        {
+            return true;
+        }
+        for (const auto& worker : workers)
+        {
+            if (!worker.deque.empty())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Announce ourselves as a sleeper, then look once more for work so a
+    // submission racing with us is not missed: either we see its task here
+    // or the submitter sees us in sleepers and releases the semaphore.
+    void sleep()
+    {
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        if (hasWork() || stopToken().stop_requested())
+        {
+            auto count = sleepers.load(std::memory_order_relaxed);
+            while (count > 0 && !sleepers.compare_exchange_weak(count, count - 1))
+            {}
+            if (count > 0)
+            {
+                return;
+            }
+            // A submitter already claimed us; take the token it released.
+        }
+        wakeup.acquire();
+    }
+
+    void wakeOne()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto count = sleepers.load(std::memory_order_relaxed);
+        while (count > 0 && !sleepers.compare_exchange_weak(count, count - 1))
+        {}
+        if (count > 0)
+        {
+            wakeup.release();
+        }
+    }
+
+    void execute(WorkerTask* task)
+    {
+        try
+        {
+            (*task)();
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR("Exception in worker task: {}", e.what());
+        }
+        release(task);
+    }
+
+    void release(WorkerTask* task)
+    {
+        task->reset();
+        if (task >= slab.get() && task < slab.get() + slabSize)
+        {
+            freeSlots.push(task);
+            return;
+        }
+        delete task;
+    }
+
+    std::unique_ptr<WorkerTask[]> slab;
+    BoundedMpmcQueue<WorkerTask*, slabSize> freeSlots;
+    BoundedMpmcQueue<WorkerTask*, slabSize> injection;
+    std::mutex overflowMutex;
+    std::deque<WorkerTask*> overflow;
+    std::atomic<std::size_t> overflowCount{0};
+    std::atomic<int> sleepers{0};
+    std::counting_semaphore<> wakeup{0};
+    std::stop_source stop_source;
+    std::vector<Worker> workers;
 };
 inline WorkerPool& getWorkerPool(int threadCount = 1)
 {
     static WorkerPool pool(threadCount);
     return pool;
 }
+// Threads for blocking file I/O (file_io.hpp, EventLog), kept apart from
+// getWorkerPool() so that a slow disk and a slow name lookup never wait on
+// each other.
+inline WorkerPool& getFileWorkerPool(int threadCount = 2)
+{
+    static WorkerPool pool(threadCount);
+    return pool;
+}
 template <typename RetType>
 inline AwaitableResult<boost::system::error_code, RetType> asyncCall(
     net::io_context& ctx, std::function<RetType()>&& task)